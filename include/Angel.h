@@ -51,6 +51,14 @@ namespace Angel {
     GLuint InitShader( const char* vertexShaderFile,
                       const char* fragmentShaderFile );
 
+    //  Same, with preprocessor definitions ("#define NAME value" lines)
+    //    inserted right after each shader's #version line. fromCache, when
+    //    given, tells whether the program came from the program cache
+    GLuint InitShader( const char* vertexShaderFile,
+                      const char* fragmentShaderFile,
+                      const char* definitions,
+                      bool* fromCache = NULL );
+
     //  Defined constant for when numbers are too small to be used in the
     //    denominator of a division operation.  This is only used if the
     //    DEBUG macro is defined.
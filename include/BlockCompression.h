@@ -0,0 +1,28 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <vector>
+
+class JobSystem;
+
+// Pixel formats a texture level can be stored and uploaded in
+enum class TextureFormat {
+    RGB8, // Uncompressed, 3 bytes per texel
+    BC1,  // 8 bytes per 4x4 block (GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+    BC7   // 16 bytes per 4x4 block (GL_COMPRESSED_RGBA_BPTC_UNORM), opaque
+};
+
+const char* textureFormatName(TextureFormat format);
+
+// Bytes needed for a width x height level; partial blocks count as whole ones
+size_t compressedLevelSize(int width, int height, TextureFormat format);
+
+// Encodes a tightly packed RGB8 image into 4x4 blocks of format (BC1 or BC7).
+// Endpoints start on the principal axis of each block's colours and are
+// refined by a least-squares refit; the per-texel index search runs four
+// texels at a time with SSE. Block rows are split across jobs when given.
+void compressImage(const unsigned char* rgb, int width, int height, TextureFormat format,
+                   std::vector<unsigned char>& out, JobSystem* jobs = nullptr);
+
+#endif // BLOCK_COMPRESSION_H
@@ -0,0 +1,62 @@
+#ifndef COLLISION_GRID_H
+#define COLLISION_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Pair of body indices whose spheres overlap (a < b)
+struct ContactPair {
+    uint32_t a;
+    uint32_t b;
+};
+
+// Uniform grid broadphase stored as a spatial hash.
+// Bodies are binned into cubic cells of cellSize; cells are hashed into a
+// power-of-two bucket table and bodies are sorted by bucket with a counting
+// sort, O(bodies + buckets). When nobody changed bucket the previous step's
+// bins are reused as they are. (Repairing the old order with an insertion
+// sort does not pay: a body that changes cell lands in an unrelated bucket,
+// so every one of them shifts about half the array.)
+class CollisionGrid {
+public:
+    CollisionGrid();
+
+    // Re-bins the bodies; cellSize should be at least the largest diameter
+    void update(const float* x, const float* y, const float* z, size_t count, float cellSize);
+
+    // Collects every overlapping pair of spheres into pairs
+    void findPairs(const float* x, const float* y, const float* z, const float* radius,
+                   std::vector<ContactPair>& pairs, JobSystem* jobs = nullptr);
+
+    // Number of bodies that changed bucket during the last update
+    size_t getRebinnedCount() const { return rebinnedCount; }
+
+private:
+    void cellOf(float px, float py, float pz, int& ix, int& iy, int& iz) const;
+    uint32_t hashCell(int ix, int iy, int iz) const;
+    void countingSort();
+    void buildBucketRanges();
+    void findPairsRange(size_t begin, size_t end, const float* x, const float* y, const float* z,
+                        const float* radius, std::vector<ContactPair>& out) const;
+
+    float cellSize;
+    float invCellSize;
+    uint32_t tableMask;
+    size_t bodyCount;
+    size_t rebinnedCount;
+
+    std::vector<uint32_t> bodyBucket;   // Bucket of every body
+    std::vector<uint32_t> sortedBodies; // Body indices ordered by bucket
+    std::vector<uint32_t> bucketStart;  // First slot in sortedBodies, valid when bucketStamp matches
+    std::vector<uint32_t> bucketEnd;
+    std::vector<uint32_t> bucketStamp;
+    std::vector<uint32_t> sortScratch;
+    uint32_t stamp;
+
+    std::vector<std::vector<ContactPair>> chunkPairs; // Per-job output of findPairs
+};
+
+#endif // COLLISION_GRID_H
@@ -0,0 +1,21 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// Compile-time availability of the x86 SIMD kernels. A kernel that is
+// compiled in is only used after the matching runtime check below passes.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SPHERE_HAS_SSE 1
+    #if defined(__GNUC__) || defined(__clang__)
+        #define SPHERE_HAS_AVX2 1
+        #define SPHERE_TARGET_AVX2 __attribute__((target("avx2")))
+    #elif defined(__AVX2__)
+        #define SPHERE_HAS_AVX2 1
+        #define SPHERE_TARGET_AVX2
+    #endif
+#endif
+
+// Runtime CPU feature queries, evaluated once and cached
+bool cpuHasSSE2();
+bool cpuHasAVX2();
+
+#endif // CPU_FEATURES_H
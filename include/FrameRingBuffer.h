@@ -0,0 +1,61 @@
+#ifndef FRAME_RING_BUFFER_H
+#define FRAME_RING_BUFFER_H
+
+#include "Angel.h"
+#include <cstddef>
+#include <vector>
+
+// Per-frame scratch memory in one GL buffer, for data that is rewritten
+// every frame (instance records, uniform blocks). The buffer is split into
+// segmentCount segments used round robin; a fence placed at the end of a
+// frame tells when the GPU is done with its segment, so the CPU writes
+// straight into memory the GPU is not reading, with no driver copy and no
+// implicit sync. With ARB_buffer_storage the buffer is persistently and
+// coherently mapped. Without it allocations go to a CPU copy that flush()
+// uploads into freshly orphaned storage.
+//
+// Per frame: beginFrame(), allocate()..., flush() before the draws that
+// read the data, endFrame() after them.
+class FrameRingBuffer {
+public:
+    FrameRingBuffer();
+
+    FrameRingBuffer(const FrameRingBuffer&) = delete;
+    FrameRingBuffer& operator=(const FrameRingBuffer&) = delete;
+
+    // Needs a current GL context
+    void init(size_t segmentBytes = defaultSegmentBytes);
+    void destroy();
+
+    // Waits (only if the GPU is segmentCount frames behind) until this
+    // frame's segment is free. The segment grows first if it is smaller
+    // than minimumBytes; pointers from earlier frames are invalid after that.
+    void beginFrame(size_t minimumBytes = 0);
+
+    // Returns write-only memory for bytes and its offset in getBuffer(), or
+    // null when the frame's segment is full
+    void* allocate(size_t bytes, size_t alignment, size_t& offset);
+
+    void flush();
+    void endFrame();
+
+    GLuint getBuffer() const { return buffer; }
+    bool isPersistent() const { return persistentData != nullptr; }
+
+    static const int segmentCount = 3;
+    static const size_t defaultSegmentBytes = 4u << 20;
+
+private:
+    void createStorage(size_t segmentBytes);
+    void releaseStorage();
+
+    GLuint buffer;
+    size_t segmentSize;
+    int segment;                   // Segment written this frame
+    size_t head;                   // Bytes used in it
+    unsigned char* persistentData; // Whole buffer, null in the orphaning fallback
+    std::vector<unsigned char> shadow; // Fallback: this frame's data until flush()
+    GLsync fences[segmentCount];
+};
+
+#endif // FRAME_RING_BUFFER_H
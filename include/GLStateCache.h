@@ -0,0 +1,88 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include "Angel.h"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Shadows the GL state the render loop sets every frame (bound program, VAO,
+// textures per unit, enables, depth/blend/polygon state and the uniforms of
+// each program) and drops calls that would not change it. Drivers do not all
+// filter these cheaply, and on software GL (llvmpipe) every call that reaches
+// the driver costs validation time on the CPU.
+//
+// Everything starts out unknown, so the first call of each kind always reaches
+// GL. Code that changes tracked state behind the cache's back must call
+// invalidate() (or invalidateTextures()) afterwards.
+class GLStateCache {
+public:
+    GLStateCache();
+
+    GLStateCache(const GLStateCache&) = delete;
+    GLStateCache& operator=(const GLStateCache&) = delete;
+
+    void invalidate();
+    void invalidateTextures();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    void setCapability(GLenum capability, bool enabled); // glEnable / glDisable
+    void depthFunc(GLenum func);
+    void depthMask(GLboolean mask);
+    void blendFunc(GLenum source, GLenum destination);
+    void polygonMode(GLenum mode); // GL_FRONT_AND_BACK, the only face core profiles accept
+
+    // Uniforms of the program bound through useProgram(); location -1 is
+    // ignored, as GL does
+    void uniform1i(GLint location, GLint value);
+    void uniform1f(GLint location, GLfloat value);
+    void uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+    void uniformMatrix4(GLint location, const mat4& m); // Row major, as Angel stores it
+
+    // Calls passed on to GL and calls dropped as redundant since the last reset
+    struct Stats {
+        size_t issued;
+        size_t elided;
+    };
+    const Stats& getStats() const { return stats; }
+    void resetStats();
+
+private:
+    struct CapabilityState {
+        GLenum capability;
+        bool enabled;
+    };
+    struct TextureBinding {
+        GLuint unit;
+        GLenum target;
+        GLuint texture;
+    };
+    struct UniformValue {
+        GLenum type; // 0 while unknown
+        GLfloat data[16];
+    };
+
+    // True when the value differs from the cached one (which is then updated)
+    bool changeUniform(GLint location, GLenum type, const void* data, size_t size);
+    bool count(bool changed);
+
+    GLuint program;
+    bool programKnown;
+    GLuint vao;
+    bool vaoKnown;
+    GLint activeUnit; // -1 while unknown
+    std::vector<TextureBinding> textures;
+    std::vector<CapabilityState> capabilities;
+    GLenum depthFuncValue;     // 0 while unknown, for this and the values below
+    GLint depthMaskValue;      // -1 while unknown
+    GLenum blendSource, blendDestination;
+    GLenum polygonModeValue;
+    std::unordered_map<GLuint, std::vector<UniformValue>> uniforms; // Per program, indexed by location
+    std::vector<UniformValue>* currentUniforms; // Those of program, null while it is unknown
+    Stats stats;
+};
+
+#endif // GL_STATE_CACHE_H
@@ -0,0 +1,79 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tracks completion of a group of submitted jobs
+struct JobCounter {
+    std::atomic<int> pending{0};
+    bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Work-stealing thread pool.
+// Every worker owns a deque: it pushes and pops its own jobs at the back
+// (LIFO, cache friendly) while idle workers steal from the front of other
+// deques. Threads that are not workers (the GLFW main thread, the simulation
+// thread) each get a queue of their own that workers steal from as well.
+// A thread waiting on a JobCounter runs only that counter's queued jobs
+// itself, never unrelated ones such as a texture load or another thread's
+// parallelFor chunks, which could hold it up far longer than its own work.
+class JobSystem {
+public:
+    // workerCount == 0 uses one worker per hardware thread minus the caller
+    explicit JobSystem(unsigned workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned getWorkerCount() const { return (unsigned)workers.size(); }
+
+    void submit(std::function<void()> job, JobCounter* counter = nullptr);
+
+    // Blocks until counter reaches zero, running the counter's own queued jobs in the meantime
+    void wait(JobCounter& counter);
+
+    // Calls body(chunkBegin, chunkEnd) over [begin, end) split into chunks of
+    // at most grainSize elements, and returns when all chunks are finished
+    void parallelFor(size_t begin, size_t end, size_t grainSize,
+                     const std::function<void(size_t, size_t)>& body);
+
+private:
+    struct Job {
+        std::function<void()> function;
+        JobCounter* counter;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void workerLoop(unsigned index);
+    bool popJob(unsigned queueIndex, Job& job);
+    bool stealJob(unsigned thiefIndex, Job& job);
+    bool popCounterJob(unsigned queueIndex, const JobCounter& counter, Job& job);
+    void runJob(Job& job);
+    unsigned currentQueueIndex();
+
+    // Queues for threads that are not workers; any beyond this share the last one
+    static const unsigned externalQueueCount = 4;
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues; // One per worker, then the external ones
+    std::atomic<unsigned> nextExternalQueue{0};
+    std::atomic<int> queuedJobs{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,47 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file.
+// On POSIX systems the file is memory mapped, so parsing reads straight
+// from the page cache without an intermediate copy; elsewhere (or if
+// mapping fails) the file is read into a buffer once.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+    const char* view;
+    size_t length;
+    bool opened;
+    bool mapped;              // view came from mmap and must be unmapped
+    std::vector<char> buffer; // Fallback storage when the file is not mapped
+};
+
+// One piece of a file written by writeFileAtomically
+struct FileChunk {
+    const void* data;
+    size_t size;
+};
+
+// Writes the chunks one after another to a temporary file next to path and
+// renames it over path, so readers never see a half-written file. The
+// temporary name is unique per process and call, so concurrent writers of
+// the same path do not clobber each other; the last rename wins.
+bool writeFileAtomically(const std::string& path, const std::vector<FileChunk>& chunks);
+
+#endif // MAPPED_FILE_H
@@ -1,5 +1,6 @@
 #pragma once
 #include <GL/glew.h>
+#include "UniformBlocks.h"
 
 class Material
 {
@@ -7,7 +8,8 @@ public:
     Material();
     Material(GLfloat sIntensity, GLfloat shine);
     
-    void UseMaterial(GLuint specularIntensityLoc, GLuint shininessLoc);
+    // Fills one materials[] element of the Materials uniform block
+    void WriteBlock(MaterialBlockEntry& entry) const;
     
     ~Material();
     
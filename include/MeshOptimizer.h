@@ -0,0 +1,42 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "Angel.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Reordering passes for any indexed triangle list (GL_TRIANGLES). They change
+// only the order of triangles and vertices, never the geometry.
+
+// Post-transform cache efficiency of an index order, from a FIFO cache
+// simulation
+struct VertexCacheStats {
+    float acmr; // Average cache miss ratio: vertex shader runs per triangle (about 0.5 at best, 3 at worst)
+    float atvr; // Average transform to vertex ratio: runs per vertex (1 at best)
+};
+
+VertexCacheStats analyzeVertexCache(const GLuint* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize = 16);
+VertexCacheStats analyzeVertexCache(const GLushort* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize = 16);
+
+// Reorders triangles so consecutive ones reuse the vertices still in the
+// post-transform cache (Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation"). The result is good for any cache size, so it is not tuned
+// to one GPU.
+void optimizeVertexCache(GLuint* indices, size_t indexCount, size_t vertexCount);
+
+// Renumbers vertices in the order the indices first use them, so vertex
+// fetch walks the buffer forwards; run it after optimizeVertexCache. Unused
+// vertices go last. Returns the new position of each old vertex, to be
+// applied with remapVertices.
+std::vector<GLuint> optimizeVertexFetch(GLuint* indices, size_t indexCount, size_t vertexCount);
+
+template <typename Vertex>
+void remapVertices(Vertex* vertices, size_t vertexCount, const std::vector<GLuint>& remap)
+{
+    std::vector<Vertex> reordered(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) reordered[remap[i]] = vertices[i];
+    std::copy(reordered.begin(), reordered.end(), vertices);
+}
+
+#endif // MESH_OPTIMIZER_H
@@ -0,0 +1,24 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include "ppm_loader.h"
+#include <vector>
+
+class JobSystem;
+
+// Downsampling filter used between mip levels
+enum class MipFilter {
+    Box,    // 2x2 average
+    Kaiser  // 6-tap Kaiser-windowed sinc, sharper and with less aliasing
+};
+
+// Builds the mip chain below base: levels[0] is half the size of base
+// (rounded down, at least 1) and the last level is 1x1.
+// Filtering happens in linear light: texels are decoded from sRGB, every
+// level is filtered from the previous one in float, and each level is
+// encoded back to sRGB with correct rounding. The separable passes use
+// SSE or AVX2 when available and the rows of a level are split across jobs.
+void buildMipChain(const PPMImage& base, std::vector<PPMImage>& levels,
+                   MipFilter filter = MipFilter::Kaiser, JobSystem* jobs = nullptr);
+
+#endif // MIPMAP_H
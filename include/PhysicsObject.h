@@ -4,6 +4,9 @@
 
 #include "Angel.h"
 
+// Height of the floor plane the objects bounce on
+extern float bottomY;
+
 class PhysicsObject {
 public:
     vec3 position;
@@ -0,0 +1,110 @@
+#ifndef PHYSICS_WORLD_H
+#define PHYSICS_WORLD_H
+
+#include "Angel.h"
+#include "CollisionGrid.h"
+#include <cstddef>
+#include <vector>
+
+class JobSystem;
+
+// Integration kernels. SIMD paths produce bit-identical results to Scalar
+// as long as the compiler does not contract the scalar mul/add pairs into
+// FMAs (-ffp-contract=off); with contraction enabled the paths may diverge
+// by a few ulps per step, see PhysicsWorld::kernelTolerance.
+enum class PhysicsKernel {
+    Scalar,
+    SSE,    // 4 bodies per instruction
+    AVX2    // 8 bodies per instruction
+};
+
+// Structure-of-arrays container for many bouncing spheres.
+// Every body follows the same rules as PhysicsObject (gravity, quadratic
+// resistance with the x-velocity threshold, floor bounce), but the state is
+// stored in flat float arrays so a whole step is one linear pass over memory.
+// After integration, overlapping spheres are found with a uniform grid and
+// pushed apart with the same restitution model as the floor bounce.
+class PhysicsWorld {
+public:
+    // Body state, one entry per body
+    std::vector<float> x, y, z;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> ax, ay, az;   // Accumulated acceleration, cleared after each step
+    std::vector<float> mass;
+    std::vector<float> invMass;
+    std::vector<float> radius;
+    std::vector<float> prevX, prevY, prevZ; // Positions before the last update, for render interpolation
+
+    // Simulation constants shared by all bodies (defaults match PhysicsObject)
+    vec3 gravity;
+    vec3 resistence;
+    float restitution;
+    float floorY;
+    float velocityThresholdX;
+    bool collisionsEnabled;
+
+    // Relative per-step tolerance between kernels when FMA contraction is on
+    static constexpr float kernelTolerance = 1e-5f;
+
+    PhysicsWorld();
+
+    // Default radius matches the rendered sphere (0.5 scaled by 0.48)
+    size_t addBody(vec3 initPos, vec3 initVel = vec3(0.0, 0.0, 0.0), float initMass = 1.0f, float initRadius = 0.24f);
+    void reserve(size_t count);
+    void clear();
+    size_t size() const { return x.size(); }
+
+    vec3 getPosition(size_t i) const { return vec3(x[i], y[i], z[i]); }
+    vec3 getVelocity(size_t i) const { return vec3(vx[i], vy[i], vz[i]); }
+    // Placing a body also resets its interpolation history so it does not streak
+    void setPosition(size_t i, vec3 p) { x[i] = prevX[i] = p.x; y[i] = prevY[i] = p.y; z[i] = prevZ[i] = p.z; }
+    void setVelocity(size_t i, vec3 v) { vx[i] = v.x; vy[i] = v.y; vz[i] = v.z; }
+    void resetAcceleration(size_t i) { ax[i] = 0.0f; ay[i] = 0.0f; az[i] = 0.0f; }
+
+    // Blends the previous and current position, alpha in [0, 1] is the
+    // fraction of a fixed step that has elapsed since the last update
+    vec3 getInterpolatedPosition(size_t i, float alpha) const {
+        return vec3(prevX[i] + (x[i] - prevX[i]) * alpha,
+                    prevY[i] + (y[i] - prevY[i]) * alpha,
+                    prevZ[i] + (z[i] - prevZ[i]) * alpha);
+    }
+
+    void applyForce(size_t i, vec3 force);
+
+    // Advances every body by deltaTime, split across jobs when given a pool
+    void update(double deltaTime, JobSystem* jobs = nullptr);
+
+    // Bodies per job when updating in parallel (kept a multiple of 8 lanes)
+    size_t parallelGrainSize;
+
+    // Advances bodies [begin, end) by deltaTime using the active kernel
+    void updateRange(size_t begin, size_t end, float deltaTime);
+
+    // Kernel selection; the default is the widest one the CPU supports.
+    // Requests for an unsupported kernel fall back to the next narrower one.
+    void setKernel(PhysicsKernel requested);
+    PhysicsKernel getKernel() const { return kernel; }
+    static PhysicsKernel bestKernel();
+    static const char* kernelName(PhysicsKernel k);
+
+    // Individual kernels, exposed so they can be checked against each other
+    void updateRangeScalar(size_t begin, size_t end, float deltaTime);
+    void updateRangeSSE(size_t begin, size_t end, float deltaTime);
+    void updateRangeAVX2(size_t begin, size_t end, float deltaTime);
+
+    // Finds overlapping spheres and resolves them with one impulse per pair
+    void solveCollisions(JobSystem* jobs = nullptr);
+
+    // Pairs found by the last solveCollisions call
+    const std::vector<ContactPair>& getContacts() const { return contacts; }
+
+private:
+    void resolveContact(uint32_t a, uint32_t b);
+
+    PhysicsKernel kernel;
+    CollisionGrid grid;
+    std::vector<ContactPair> contacts;
+    float maxRadius;
+};
+
+#endif // PHYSICS_WORLD_H
@@ -0,0 +1,36 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "Angel.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (ARB_get_program_binary), used by
+// InitShader so later runs skip compiling and linking. Each program has its
+// own file, named after its shader files and definitions. The file records a
+// hash of the shader text and of the GL vendor, renderer and version strings;
+// a new driver or an edited shader misses the cache, and the program is
+// rebuilt from source and stored again. Binaries are only meaningful to the
+// driver that wrote them, so the cache is never shared between machines.
+
+// Bumped whenever the file layout changes
+const uint32_t programCacheVersion = 1;
+
+// True when the context can save and load program binaries
+bool programBinariesSupported();
+
+// FNV-1a over text, chained through seed so several strings hash as one
+uint64_t hashShaderText(const char* text, size_t size, uint64_t seed = 14695981039346656037ull);
+
+std::string programCachePath(const char* vertexShaderFile, const char* fragmentShaderFile, const char* definitions);
+
+// Returns the cached program, linked and ready, or 0 when there is no usable
+// binary for sourceHash and this driver
+GLuint loadProgramBinary(const std::string& path, uint64_t sourceHash);
+
+// Writes program's binary; the program must have been linked with
+// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+bool saveProgramBinary(const std::string& path, uint64_t sourceHash, GLuint program);
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,67 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "Angel.h"
+#include <string>
+#include <unordered_map>
+
+// Texture path compiled into a variant (TEXTURE_MODE in the shaders)
+enum class ShaderTexture {
+    None = 0,
+    Texture2D = 1, // Layer of a texture array
+    Texture1D = 2  // Stripes along u_1DTexturePlane
+};
+
+// What the renderer is about to draw; selects a variant
+struct ShaderVariantKey {
+    int shadingMode; // 0: Gouraud, 1: Phong
+    ShaderTexture texture;
+    bool shadowPass;
+};
+
+// One compiled variant and the locations of the plain uniforms it uses (-1
+// when the variant does not use them). Everything else comes from uniform
+// blocks, and the samplers are fixed to units 0 (2D) and 1 (1D) at link time.
+struct ShaderVariant {
+    GLuint program;
+    GLint shadowMatrix;
+    GLint shadowColor;
+    GLint texturePlane;
+    GLint stripeScale;
+};
+
+// Builds specialized versions of one vertex/fragment shader pair on demand.
+// Instead of branching on mode uniforms, the shaders test SHADING_MODE,
+// TEXTURE_MODE and SHADOW_PASS with the preprocessor, so each program only
+// contains the path it draws. Keys that produce the same code share a
+// program: the shadow pass ignores shading and texture, and textured
+// variants are always lit per fragment.
+class ShaderVariants {
+public:
+    ShaderVariants();
+    ~ShaderVariants();
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    void init(const char* vertexShaderFile, const char* fragmentShaderFile);
+
+    // Compiles the variant the first time it is asked for; compiling binds
+    // the new program. Exits on compile errors, like InitShader.
+    const ShaderVariant& get(const ShaderVariantKey& key);
+
+    // Deletes every program; needs the GL context
+    void clear();
+
+    size_t size() const { return variants.size(); }
+
+private:
+    static ShaderVariantKey normalize(ShaderVariantKey key);
+    static unsigned packKey(const ShaderVariantKey& key);
+
+    std::string vertexFile;
+    std::string fragmentFile;
+    std::unordered_map<unsigned, ShaderVariant> variants;
+};
+
+#endif // SHADER_VARIANTS_H
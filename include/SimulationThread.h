@@ -0,0 +1,97 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include "Angel.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+class PhysicsWorld;
+
+// State published by the simulation thread after each batch of steps.
+// The previous* fields hold the state one step earlier, so the renderer can
+// interpolate across the last step.
+struct SimulationSnapshot {
+    std::vector<vec3> previousPositions;
+    std::vector<vec3> positions;
+    std::vector<float> radii;
+    float previousTheta[3];
+    float theta[3];
+    std::chrono::steady_clock::time_point stepTime; // When positions became current
+    unsigned long long stepCount;
+};
+
+enum class SimulationCommandType {
+    ResetBody,  // Place body at position with velocity and no pending forces
+    SpawnBodies // Add count bodies of radius scattered around position, all moving with velocity
+};
+
+// Input events forwarded from the GLFW thread to the simulation thread
+struct SimulationCommand {
+    SimulationCommandType type;
+    size_t body;
+    size_t count;
+    float radius;
+    vec3 position;
+    vec3 velocity;
+};
+
+// Runs PhysicsWorld on its own thread at a fixed step.
+// Snapshots go to the render thread through a lock-free triple buffer and
+// commands come back through a lock-free SPSC queue, so neither thread ever
+// blocks on the other. The world must not be touched by other threads
+// between start() and stop().
+class SimulationThread {
+public:
+    SimulationThread();
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    // rotationAxis/rotationSpeed drive the Theta[] angles (degrees per second)
+    void start(PhysicsWorld& world, JobSystem* jobs, double timeStep, int rotationAxis, float rotationSpeed);
+    void stop();
+    bool isRunning() const { return thread.joinable(); }
+
+    // Producer side of the command queue; returns false when it is full
+    bool sendCommand(const SimulationCommand& command);
+
+    // Render thread: newest published snapshot and how far (0..1) the
+    // current time is past its step, for interpolation
+    const SimulationSnapshot& acquireSnapshot();
+    float interpolationAlpha(const SimulationSnapshot& snapshot) const;
+
+    // Upper bound on steps taken in one batch before simulated time is dropped
+    int maxStepsPerBatch;
+
+private:
+    void run();
+    void applyCommands();
+    void spawnBodies(const SimulationCommand& command);
+    void step();
+    void publish();
+
+    PhysicsWorld* world;
+    JobSystem* jobs;
+    double timeStep;
+    int rotationAxis;
+    float rotationSpeed;
+    float theta[3];
+    float previousTheta[3];
+    unsigned long long stepCount;
+    uint32_t spawnSeed;
+
+    std::thread thread;
+    std::atomic<bool> running;
+    TripleBuffer<SimulationSnapshot> snapshots;
+    SpscQueue<SimulationCommand, 64> commands;
+};
+
+#endif // SIMULATION_THREAD_H
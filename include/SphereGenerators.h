@@ -0,0 +1,41 @@
+#ifndef SPHERE_GENERATORS_H
+#define SPHERE_GENERATORS_H
+
+#include "Angel.h"
+#include <vector>
+
+// Alternatives to the latitude/longitude sphere for SphereMesh. The UV sphere
+// crowds thin triangles into the poles; these spread them almost evenly over
+// the surface, so the same error needs far fewer triangles, and every
+// interior vertex is shared by about six of them.
+
+// A triangle mesh on the unit sphere: one direction (position and normal)
+// per vertex, triangles counter-clockwise seen from outside
+struct SphereGeometry {
+    std::vector<vec3> directions;
+    std::vector<vec2> texCoords; // Empty until addSphereTexCoords
+    std::vector<GLuint> indices;
+};
+
+// Icosahedron with every triangle split into four subdivisions times:
+// 20 * 4^subdivisions triangles. Edge midpoints are cached so neighbouring
+// triangles share them.
+void generateIcosphere(int subdivisions, SphereGeometry& geometry);
+
+// Cube with divisions x divisions quads a face, each point moved onto the
+// sphere with the spherified-cube mapping rather than plain normalization,
+// which crowds vertices toward the cube's edges and corners. Odd
+// divisions are rounded up so the texture seam and the poles fall on
+// vertices. 12 * divisions^2 triangles.
+void generateCubeSphere(int divisions, SphereGeometry& geometry);
+
+// Fills texCoords with the equirectangular mapping of the UV sphere (u from
+// longitude, v from latitude). Triangles crossing the u = 0/1 seam are split
+// along it and the pole vertices get one copy per triangle, so no texture
+// coordinate has to leave [0, 1] (the packed vertex stores them as unorm16).
+void addSphereTexCoords(SphereGeometry& geometry);
+
+// Largest distance between a triangle and the sphere, as a fraction of the radius
+float sphereGeometryError(const SphereGeometry& geometry);
+
+#endif // SPHERE_GENERATORS_H
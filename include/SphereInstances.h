@@ -0,0 +1,91 @@
+#ifndef SPHERE_INSTANCES_H
+#define SPHERE_INSTANCES_H
+
+#include "Angel.h"
+#include "TextureArrays.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FrameRingBuffer;
+class JobSystem;
+struct SimulationSnapshot;
+
+// Per-instance vertex data for one sphere, read by vshader.glsl through
+// attributes with a divisor of 1
+struct SphereInstance {
+    GLfloat model[16];     // Column-major model matrix (locations first..first+3)
+    GLfloat materialIndex; // Entry of the shader's materials[] table (location first+4)
+    GLfloat textureLayer;  // Layer in the batch's texture array
+    GLfloat padding[2];
+};
+
+// A run of instances sharing one mesh level of detail and one texture array,
+// drawn with one bind and one glDrawElementsInstancedBaseVertex call
+struct SphereBatch {
+    int lod;
+    GLuint textureArray;
+    size_t first;
+    size_t count;
+};
+
+// Builds the instance data of every simulated sphere each frame straight
+// into the frame ring buffer, where the instance attributes of the sphere VAO
+// read it. Each sphere also picks a level of the mesh's LOD chain from its
+// projected size, and instances are grouped by level and texture array, so a
+// scene is a handful of draws no matter how many spheres it holds.
+class SphereInstances {
+public:
+    SphereInstances();
+
+    SphereInstances(const SphereInstances&) = delete;
+    SphereInstances& operator=(const SphereInstances&) = delete;
+
+    // Enables the instance attributes on vao
+    void init(GLuint vao, GLuint firstLocation);
+
+    // Relative geometric error of each mesh level, finest first
+    // (SphereLod::relativeError). Without levels every sphere uses level 0.
+    void setLodErrors(const std::vector<float>& errors);
+
+    // rotation is shared by all spheres; each one is scaled from meshRadius
+    // to its body radius. materials and textures are indexed by body; an
+    // empty textures vector puts every sphere in one untextured batch.
+    // view and pixelsPerUnit (projection[1][1] * viewport height / 2, so it
+    // follows the zoom) project each radius to pixels for the LOD choice.
+    // Returns false (and leaves no batches) when the ring segment is full.
+    bool build(const SimulationSnapshot& snapshot, float alpha, const mat4& rotation, float meshRadius,
+               const std::vector<int>& materials, const std::vector<TextureSlot>& textures,
+               const mat4& view, float pixelsPerUnit, FrameRingBuffer& ring, JobSystem* jobs = nullptr);
+
+    // Points the instance attributes at the batch; the sphere VAO must be bound
+    void bindBatch(const SphereBatch& batch) const;
+
+    const std::vector<SphereBatch>& getBatches() const { return batches; }
+    size_t size() const { return count; }
+
+    // Bodies per job when filling instances in parallel
+    size_t parallelGrainSize;
+
+    // Largest silhouette error allowed, in pixels. A sphere moves to a
+    // coarser level only once that level's error is below
+    // maxScreenError * lodHysteresis, so one near the threshold does not
+    // switch back and forth every frame.
+    float maxScreenError;
+    float lodHysteresis;
+
+private:
+    GLuint vao;
+    GLuint firstLocation;
+    GLuint buffer;       // Ring buffer holding this frame's instances
+    size_t bufferOffset; // Where they start in it
+    size_t count;
+
+    std::vector<float> lodErrors;
+    std::vector<uint8_t> lodOfBody; // Kept between frames for the hysteresis
+    std::vector<SphereBatch> batches;
+    std::vector<uint32_t> batchOfBody;
+    std::vector<uint32_t> bodyOfSlot; // Body drawn by each instance slot
+};
+
+#endif // SPHERE_INSTANCES_H
@@ -0,0 +1,115 @@
+#ifndef SPHERE_MESH_H
+#define SPHERE_MESH_H
+
+#include "Angel.h"
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+struct SphereTable;
+
+// Vertex layout of the sphere mesh, chosen at build time. The packed layout
+// (the default) is 16 bytes a vertex: snorm16 position, GL_INT_2_10_10_10_REV
+// normal and unorm16 texture coordinates. Build with
+// -DSPHERE_PACKED_VERTICES=0 for 32-byte float vertices, e.g. to rule out
+// quantization when debugging. Either way the vertex shader sees the same
+// vPosition / vNormal / aTexCoord inputs.
+#ifndef SPHERE_PACKED_VERTICES
+#define SPHERE_PACKED_VERTICES 1
+#endif
+
+#if SPHERE_PACKED_VERTICES
+struct SphereVertex {
+    GLshort position[4]; // xyz snorm16 on the unit sphere; [3] pads to 8 bytes (w reads as 1)
+    GLuint normal;       // Signed 10:10:10:2, w unused
+    GLushort texCoord[2];
+};
+#else
+struct SphereVertex {
+    GLfloat position[3];
+    GLfloat normal[3];
+    GLfloat texCoord[2];
+};
+#endif
+
+// How the sphere is tessellated (see SphereGenerators.h)
+enum class SphereTopology {
+    UVSphere,   // Latitude/longitude bands
+    Icosphere,  // Subdivided icosahedron
+    CubeSphere  // Subdivided cube
+};
+
+// One level of detail: a range of the shared index buffer, whose indices
+// count from baseVertex (glDrawElements*BaseVertex)
+struct SphereLod {
+    int detail;          // Bands, subdivisions or face divisions, by topology
+    GLint baseVertex;
+    size_t vertexCount;
+    size_t firstIndex;
+    GLsizei indexCount;
+    float relativeError;      // Largest distance from the true sphere, as a fraction of the radius
+    const SphereTable* table; // Compile-time data of the level, or nullptr when generated
+};
+
+// A chain of spheres of radius 1, finest first, in one interleaved vertex
+// buffer and one index buffer. Indices are local to their
+// level, so they are 16-bit whenever the largest level allows. Each level's
+// triangles and vertices are reordered for the post-transform cache and for
+// vertex fetch (MeshOptimizer.h; tools/mesh_cache_report.cpp measures the
+// gain). UV sphere chains whose levels all have
+// compile-time tables (SphereMeshTables.h) are uploaded straight from them. Instances
+// scale the mesh to their body radius. Every vertex was red, so the colour is
+// no longer stored per vertex: vColor (location 1) reads a constant attribute
+// value instead of a buffer.
+class SphereMesh {
+public:
+    SphereMesh();
+
+    SphereMesh(const SphereMesh&) = delete;
+    SphereMesh& operator=(const SphereMesh&) = delete;
+
+    // One level per entry of levelDetail, finest first. With jobs, UV sphere
+    // rows, or the other topologies' levels, are generated in parallel.
+    void generate(SphereTopology topology, const std::vector<int>& levelDetail, JobSystem* jobs = nullptr);
+
+    // Creates the VAO with the vertex and index buffers; needs the GL context
+    void upload();
+    void destroy();
+
+    GLuint getVAO() const { return vao; }
+    SphereTopology getTopology() const { return topology; }
+    GLenum getIndexType() const { return indexType; }
+    size_t getIndexSize() const { return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+    size_t getVertexCount() const { return lods.empty() ? 0 : lods.back().baseVertex + lods.back().vertexCount; }
+    bool usesTables() const { return !lods.empty() && lods[0].table != nullptr; }
+    const std::vector<SphereLod>& getLods() const { return lods; }
+
+    // Empty when the levels come from the compile-time tables
+    const std::vector<SphereVertex>& getVertices() const { return vertices; }
+    const std::vector<GLuint>& getIndices() const { return indices; }
+
+    static const GLuint positionLocation = 0;
+    static const GLuint colorLocation = 1;
+    static const GLuint normalLocation = 2;
+    static const GLuint texCoordLocation = 3;
+
+private:
+    void generateUVLevel(const SphereLod& lod, JobSystem* jobs);
+    void generateGeometryLevels(const std::vector<int>& levelDetail, JobSystem* jobs);
+    bool useTables(const std::vector<int>& levelBands);
+    void optimizeLevel(SphereLod& lod);
+
+    SphereTopology topology;
+    std::vector<SphereLod> lods;
+    std::vector<SphereVertex> vertices;
+    std::vector<GLuint> indices;
+    GLuint vao;
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    GLenum indexType;
+};
+
+// Quantizes a vertex; direction must be unit length, texCoord in [0, 1]
+SphereVertex packSphereVertex(const vec3& direction, const vec2& texCoord);
+
+#endif // SPHERE_MESH_H
@@ -0,0 +1,196 @@
+#ifndef SPHERE_MESH_TABLES_H
+#define SPHERE_MESH_TABLES_H
+
+#include "SphereMesh.h"
+#include <array>
+#include <cstddef>
+
+// UV sphere vertices, 16-bit indices and errors computed by the compiler, so
+// the common tessellations cost no trigonometry and no allocation at startup.
+// SphereMeshTable<Lat, Lon> holds the same vertices as SphereMesh's
+// generated UV sphere (same SPHERE_PACKED_VERTICES layout, computed in
+// double precision, so packed values may differ by one unit of rounding).
+// The tables walk the grid in vertical stripes of sphereTableStripeWidth
+// quads, an order that suits the post-transform cache better than the row
+// order and needs no runtime optimization pass. Vertices are numbered in the
+// order those triangles first use them, as optimizeVertexFetch would leave
+// them, so vertex fetch walks the buffer forwards too.
+//
+// Everything below is C++11 constexpr, hence single-expression functions and
+// pack expansions instead of loops.
+
+// Two rows of a stripe, 2 * (7 + 1) vertices, fill a 16-entry FIFO cache
+const int sphereTableStripeWidth = 7;
+
+// Index sequence 0..N-1, built in log(N) template depth
+template <size_t... I> struct SphereTableSequence { typedef SphereTableSequence type; };
+
+template <class A, class B> struct ConcatSphereTableSequence;
+template <size_t... A, size_t... B>
+struct ConcatSphereTableSequence<SphereTableSequence<A...>, SphereTableSequence<B...>> {
+    typedef SphereTableSequence<A..., (sizeof...(A) + B)...> type;
+};
+
+template <size_t N> struct MakeSphereTableSequence
+    : ConcatSphereTableSequence<typename MakeSphereTableSequence<N / 2>::type,
+                                typename MakeSphereTableSequence<N - N / 2>::type> {};
+template <> struct MakeSphereTableSequence<0> { typedef SphereTableSequence<> type; };
+template <> struct MakeSphereTableSequence<1> { typedef SphereTableSequence<0> type; };
+
+// Trigonometry and vertex packing usable in constant expressions
+struct SphereTableMath {
+    static constexpr double pi = 3.14159265358979323846;
+
+    // Taylor series on [0, pi/2]; term is x^n / n!
+    static constexpr double sinSeries(double x, double term, int n) {
+        return n > 27 ? 0.0 : term + sinSeries(x, -term * x * x / ((n + 1) * (n + 2)), n + 2);
+    }
+    // x >= 0
+    static constexpr double sin(double x) {
+        return x > pi ? -sin(x - pi) : (x > pi / 2 ? sinSeries(pi - x, pi - x, 1) : sinSeries(x, x, 1));
+    }
+    static constexpr double cos(double x) { return sin(x + pi / 2); }
+
+    static constexpr double clamp(double value, double low, double high) {
+        return value < low ? low : (value > high ? high : value);
+    }
+    // Rounds halves away from zero, like std::lround
+    static constexpr long roundAway(double value) {
+        return value >= 0.0 ? (long)(value + 0.5) : -(long)(-value + 0.5);
+    }
+    static constexpr GLshort snorm16(double value) { return (GLshort)roundAway(clamp(value, -1.0, 1.0) * 32767.0); }
+    static constexpr GLushort unorm16(double value) { return (GLushort)roundAway(clamp(value, 0.0, 1.0) * 65535.0); }
+    static constexpr GLuint snorm10(double value) { return (GLuint)roundAway(clamp(value, -1.0, 1.0) * 511.0) & 0x3ffu; }
+
+    // Same packing as packSphereVertex
+    static constexpr SphereVertex vertex(double x, double y, double z, double u, double v) {
+#if SPHERE_PACKED_VERTICES
+        return SphereVertex{ { snorm16(x), snorm16(y), snorm16(z), 0 },
+                             snorm10(x) | (snorm10(y) << 10) | (snorm10(z) << 20),
+                             { unorm16(u), unorm16(v) } };
+#else
+        return SphereVertex{ { (GLfloat)x, (GLfloat)y, (GLfloat)z },
+                             { (GLfloat)x, (GLfloat)y, (GLfloat)z },
+                             { (GLfloat)u, (GLfloat)v } };
+#endif
+    }
+};
+
+template <int Lat, int Lon>
+struct SphereTableGenerator : SphereTableMath {
+    static const size_t rowVertices = Lon + 1;
+    static const size_t columnVertices = Lat + 1;
+    static const size_t stripeQuads = (size_t)sphereTableStripeWidth * Lat;
+
+    // Quad q lies in stripe q / stripeQuads, which is sphereTableStripeWidth
+    // quads wide (the last one may be narrower) and runs from pole to pole
+    static constexpr size_t stripeOf(size_t q) { return q / stripeQuads; }
+    static constexpr size_t stripeWidth(size_t stripe) {
+        return Lon - stripe * sphereTableStripeWidth < (size_t)sphereTableStripeWidth ? Lon - stripe * sphereTableStripeWidth
+                                                                                      : (size_t)sphereTableStripeWidth;
+    }
+    static constexpr size_t quadCorner(size_t stripe, size_t inStripe) {
+        return (inStripe / stripeWidth(stripe)) * rowVertices + stripe * sphereTableStripeWidth + inStripe % stripeWidth(stripe);
+    }
+    // Same two triangles a quad as SphereMesh
+    static constexpr size_t cornerOffset(size_t corner) {
+        return corner == 0 ? 0 : (corner == 2 || corner == 5 ? 1 : (corner == 4 ? rowVertices + 1 : rowVertices));
+    }
+    // Index in SphereMesh's numbering, (lat, lon) = (v / rowVertices, v % rowVertices)
+    static constexpr size_t gridIndexAt(size_t i) {
+        return quadCorner(stripeOf(i / 6), i / 6 - stripeOf(i / 6) * stripeQuads) + cornerOffset(i % 6);
+    }
+
+    // First-use numbering. A stripe introduces the columns its left
+    // neighbour has not used: all of its columns for stripe 0, all but the
+    // shared left edge after that. Its first quad row introduces rows 0 and
+    // 1 a column at a time, each later quad row introduces the row below it.
+    static constexpr size_t firstOwnedColumn(size_t stripe) { return stripe * sphereTableStripeWidth + (stripe == 0 ? 0 : 1); }
+    static constexpr size_t ownedColumns(size_t stripe) { return stripeWidth(stripe) + (stripe == 0 ? 1 : 0); }
+    static constexpr size_t stripeFirstVertex(size_t stripe) { return firstOwnedColumn(stripe) * columnVertices; }
+    static constexpr size_t stripeOfColumn(size_t lon) { return lon == 0 ? 0 : (lon - 1) / sphereTableStripeWidth; }
+
+    // Position in the stripe's run of vertex (lat, column), column counted from firstOwnedColumn
+    static constexpr size_t orderInStripe(size_t lat, size_t column, size_t columns) {
+        return lat < 2 ? column * 2 + lat : 2 * columns + (lat - 2) * columns + column;
+    }
+    static constexpr size_t firstUseIndex(size_t lat, size_t lon) {
+        return stripeFirstVertex(stripeOfColumn(lon)) +
+               orderInStripe(lat, lon - firstOwnedColumn(stripeOfColumn(lon)), ownedColumns(stripeOfColumn(lon)));
+    }
+    static constexpr GLushort indexAt(size_t i) {
+        return (GLushort)firstUseIndex(gridIndexAt(i) / rowVertices, gridIndexAt(i) % rowVertices);
+    }
+
+    // The inverse: latitude and longitude of vertex v
+    static constexpr size_t stripeOfVertex(size_t v) {
+        return v / columnVertices == 0 ? 0 : (v / columnVertices - 1) / sphereTableStripeWidth;
+    }
+    static constexpr size_t latInStripe(size_t j, size_t columns) { return j < 2 * columns ? j % 2 : 2 + (j - 2 * columns) / columns; }
+    static constexpr size_t columnInStripe(size_t j, size_t columns) { return j < 2 * columns ? j / 2 : (j - 2 * columns) % columns; }
+    static constexpr size_t latOf(size_t v) {
+        return latInStripe(v - stripeFirstVertex(stripeOfVertex(v)), ownedColumns(stripeOfVertex(v)));
+    }
+    static constexpr size_t lonOf(size_t v) {
+        return firstOwnedColumn(stripeOfVertex(v)) +
+               columnInStripe(v - stripeFirstVertex(stripeOfVertex(v)), ownedColumns(stripeOfVertex(v)));
+    }
+
+    // Each sine is evaluated once per vertex; they dominate the compile time
+    static constexpr SphereVertex vertexAt(double sinTheta, double cosTheta, double sinPhi, double cosPhi, size_t lat, size_t lon) {
+        return vertex(cosPhi * sinTheta, cosTheta, sinPhi * sinTheta, (double)lon / Lon, 1.0 - (double)lat / Lat);
+    }
+    static constexpr SphereVertex vertexAt(double theta, double phi, size_t lat, size_t lon) {
+        return vertexAt(sin(theta), cos(theta), sin(phi), cos(phi), lat, lon);
+    }
+    static constexpr SphereVertex vertexAt(size_t lat, size_t lon) {
+        return vertexAt((double)lat * pi / Lat, (double)lon * 2.0 * pi / Lon, lat, lon);
+    }
+    static constexpr SphereVertex vertexAt(size_t v) { return vertexAt(latOf(v), lonOf(v)); }
+
+    // Largest distance from the true sphere, as a fraction of the radius: at
+    // a face centre, half a latitude step and half a longitude step away
+    static constexpr double relativeError() { return 1.0 - cos(pi / (2 * Lat)) * cos(pi / Lon); }
+
+    template <size_t... I>
+    static constexpr std::array<SphereVertex, sizeof...(I)> vertices(SphereTableSequence<I...>) { return {{ vertexAt(I)... }}; }
+    template <size_t... I>
+    static constexpr std::array<GLushort, sizeof...(I)> indices(SphereTableSequence<I...>) { return {{ indexAt(I)... }}; }
+};
+
+template <int Lat, int Lon>
+struct SphereMeshTable {
+    static_assert((Lat + 1) * (Lon + 1) <= 0x10000, "SphereMeshTable indices are 16-bit");
+
+    static const size_t vertexCount = (size_t)(Lat + 1) * (Lon + 1);
+    static const size_t indexCount = (size_t)Lat * Lon * 6;
+    static constexpr float relativeError = (float)SphereTableGenerator<Lat, Lon>::relativeError();
+
+    static constexpr std::array<SphereVertex, vertexCount> vertices =
+        SphereTableGenerator<Lat, Lon>::vertices(typename MakeSphereTableSequence<vertexCount>::type());
+    static constexpr std::array<GLushort, indexCount> indices =
+        SphereTableGenerator<Lat, Lon>::indices(typename MakeSphereTableSequence<indexCount>::type());
+};
+
+template <int Lat, int Lon>
+constexpr float SphereMeshTable<Lat, Lon>::relativeError;
+template <int Lat, int Lon>
+constexpr std::array<SphereVertex, SphereMeshTable<Lat, Lon>::vertexCount> SphereMeshTable<Lat, Lon>::vertices;
+template <int Lat, int Lon>
+constexpr std::array<GLushort, SphereMeshTable<Lat, Lon>::indexCount> SphereMeshTable<Lat, Lon>::indices;
+
+// One baked UV sphere with as many latitude as longitude bands
+struct SphereTable {
+    int bands;
+    const SphereVertex* vertices;
+    size_t vertexCount;
+    const GLushort* indices;
+    size_t indexCount;
+    float relativeError; // Same measure as SphereLod::relativeError
+};
+
+// The table for bands, or nullptr when that tessellation is not baked
+// (SphereMeshTables.cpp lists the ones that are)
+const SphereTable* findSphereTable(int bands);
+
+#endif // SPHERE_MESH_TABLES_H
@@ -0,0 +1,58 @@
+#ifndef TEXTURE_ARRAYS_H
+#define TEXTURE_ARRAYS_H
+
+#include "Angel.h"
+#include "BlockCompression.h"
+#include <vector>
+
+// Where a texture lives: a layer of a GL_TEXTURE_2D_ARRAY
+struct TextureSlot {
+    GLuint array; // 0 when the texture is not (yet) available
+    int layer;
+};
+
+// Packs 2D textures of the same size, mip count and format into shared
+// GL_TEXTURE_2D_ARRAY objects, layersPerArray layers each. Spheres keep a
+// TextureSlot instead of a texture ID, so any number of differently
+// textured spheres whose textures share an array are drawn with one bind;
+// the shader picks the layer. A new array is created whenever every array
+// of a shape is full, and released layers are reused.
+class TextureArrays {
+public:
+    TextureArrays();
+    ~TextureArrays();
+
+    TextureArrays(const TextureArrays&) = delete;
+    TextureArrays& operator=(const TextureArrays&) = delete;
+
+    // Reserves a layer, creating an array if needed. Array storage is
+    // allocated from client memory, so no pixel unpack buffer may be bound.
+    TextureSlot allocate(int width, int height, int levelCount, TextureFormat format);
+    void release(const TextureSlot& slot);
+
+    // Fills one mip level of a layer. pixels is read from the bound pixel
+    // unpack buffer (as an offset) when there is one.
+    void upload(const TextureSlot& slot, int level, int width, int height, const void* pixels, size_t size);
+
+    // Deletes every array; needs the GL context
+    void clear();
+
+    int layersPerArray;
+
+private:
+    struct ArrayInfo {
+        GLuint texture;
+        int width;
+        int height;
+        int levelCount;
+        TextureFormat format;
+        std::vector<int> freeLayers;
+    };
+
+    ArrayInfo* findArray(GLuint texture);
+    ArrayInfo& createArray(int width, int height, int levelCount, TextureFormat format);
+
+    std::vector<ArrayInfo> arrays;
+};
+
+#endif // TEXTURE_ARRAYS_H
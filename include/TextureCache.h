@@ -0,0 +1,65 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "BlockCompression.h"
+#include "MappedFile.h"
+#include "ppm_loader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// One mip level, either inside a mapped cache file or in decoded memory
+struct TextureLevel {
+    int width;
+    int height;
+    const unsigned char* pixels; // RGB8 texels or compressed blocks, see CachedTexture::getFormat
+    size_t size;                 // Bytes at pixels
+};
+
+// Decoded texture with its full mip chain.
+// The first time a source image is loaded it is decoded, the mip chain is
+// built on the CPU, every level is optionally block compressed, and the
+// result is written to "<source>.texcache". Later loads
+// map that file and point the levels straight into it, so there is nothing
+// to parse. The cache is keyed by the source size and modification time;
+// when those differ, the source content hash decides whether it is stale.
+// A cache holding a different format than requested is rebuilt.
+class CachedTexture {
+public:
+    CachedTexture();
+
+    CachedTexture(const CachedTexture&) = delete;
+    CachedTexture& operator=(const CachedTexture&) = delete;
+
+    // A failed cache write does not fail the load, the texture is still
+    // usable; cacheStored, when given, tells whether "<source>.texcache" now
+    // holds it (mapped from there, or freshly written)
+    bool load(const std::string& sourcePath, TextureFormat format = TextureFormat::RGB8, JobSystem* jobs = nullptr,
+              bool* cacheStored = nullptr);
+
+    bool isValid() const { return !levels.empty(); }
+    bool isFromCache() const { return fromCache; }
+    TextureFormat getFormat() const { return format; }
+    int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+    int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+    const std::vector<TextureLevel>& getLevels() const { return levels; }
+
+    // Bumped whenever the file layout or the mip filter changes
+    static const uint32_t formatVersion = 3;
+
+private:
+    bool mapCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime, const std::string& sourcePath);
+    bool writeCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime, uint64_t sourceHash) const;
+
+    std::vector<TextureLevel> levels;
+    bool fromCache;
+    TextureFormat format;
+    MappedFile cacheFile;               // Backs levels when loaded from the cache
+    PPMImage base;                      // Backs levels when freshly decoded
+    std::vector<PPMImage> mipLevels;
+    std::vector<std::vector<unsigned char>> compressedLevels;
+};
+
+#endif // TEXTURE_CACHE_H
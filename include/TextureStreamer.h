@@ -0,0 +1,97 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "Angel.h"
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "TextureArrays.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CachedTexture;
+
+// Streams 2D textures to the GPU without blocking the render loop.
+// Each request is loaded (cache mapped, or decoded and compressed) on the job
+// system, copied by a worker into a staging ring inside a pixel unpack
+// buffer, and uploaded from there by update() on the GL thread. A fence
+// after the upload tells the ring when the staging space can be reused;
+// once it has signalled the texture becomes visible through getTexture().
+// Textures are uploaded into layers of the shared TextureArrays.
+// The ring is persistently mapped when ARB_buffer_storage is available and
+// mapped per upload (unsynchronized, fenced the same way) otherwise.
+class TextureStreamer {
+public:
+    typedef size_t Handle;
+
+    TextureStreamer();
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Needs a current GL context
+    void init(JobSystem& jobs, TextureArrays& arrays, size_t stagingBytes = defaultStagingBytes);
+    // Waits for outstanding loads, releases the layers and frees the staging
+    // buffer; call before the context goes away
+    void shutdown();
+
+    Handle request(const std::string& path, TextureFormat format);
+
+    // GL thread, once per frame: advances every request by at most one stage
+    void update();
+
+    // Array 0 until the texture is fully uploaded (or if it failed to load)
+    TextureSlot getTexture(Handle handle) const;
+    bool isPending(Handle handle) const;
+
+    static const size_t defaultStagingBytes = 16u << 20;
+
+private:
+    enum class StreamState { Loading, Loaded, Copying, Uploading, Ready, Failed };
+
+    struct StreamRequest {
+        std::string path;
+        TextureFormat format;
+        StreamState state;
+        std::unique_ptr<CachedTexture> texture;
+        JobCounter job;              // Load, then staging copy
+        std::vector<size_t> levelOffsets;
+        size_t stagingOffset;
+        size_t stagingSize;
+        uint64_t regionSerial;
+        unsigned char* stagingData;  // Mapped staging space the worker copies into
+        TextureSlot slot;
+    };
+
+    // Staging space handed out in FIFO order; a region is reclaimed once the
+    // fence placed after the uploads reading it has signalled
+    struct StagingRegion {
+        size_t offset;
+        size_t size;
+        GLsync fence;
+    };
+
+    void beginStaging(StreamRequest& request);
+    void finishStaging(StreamRequest& request);
+    void uploadLevels(const CachedTexture& texture, const TextureSlot& slot, const std::vector<size_t>* offsets);
+    bool allocateStaging(size_t size, size_t& offset);
+    void retireStaging();
+    bool isRetired(uint64_t serial) const { return serial < firstLiveSerial; }
+
+    JobSystem* jobs;
+    TextureArrays* arrays;
+    std::vector<std::unique_ptr<StreamRequest>> requests;
+
+    GLuint stagingBuffer;
+    size_t stagingCapacity;
+    unsigned char* persistentData; // Null when the ring is mapped per upload
+    bool stagingMapped;            // Per-upload mapping is live; only one range can be mapped at a time
+    size_t stagingHead;
+    std::deque<StagingRegion> regions;
+    uint64_t firstLiveSerial;      // Serial of regions.front()
+};
+
+#endif // TEXTURE_STREAMER_H
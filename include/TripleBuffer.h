@@ -0,0 +1,46 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer single-consumer triple buffer.
+// The writer fills its back buffer and publishes it by swapping it with the
+// middle slot; the reader swaps the middle slot into its front buffer when a
+// newer one was published. Neither side ever waits for the other, and the
+// reader always sees the most recently published value in full.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : backIndex(0), middleState(1), frontIndex(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side
+    T& writeBuffer() { return buffers[backIndex]; }
+    void publish() {
+        uint8_t previous = middleState.exchange(uint8_t(backIndex | dirtyBit), std::memory_order_acq_rel);
+        backIndex = previous & indexMask;
+    }
+
+    // Reader side; returns true when a newer buffer was swapped in
+    bool update() {
+        if ((middleState.load(std::memory_order_relaxed) & dirtyBit) == 0) return false;
+        uint8_t previous = middleState.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & indexMask;
+        return true;
+    }
+    const T& readBuffer() const { return buffers[frontIndex]; }
+
+private:
+    static const uint8_t indexMask = 3;
+    static const uint8_t dirtyBit = 4; // Set while the middle slot holds an unread buffer
+
+    T buffers[3];
+    alignas(64) uint8_t backIndex;              // Owned by the writer
+    alignas(64) std::atomic<uint8_t> middleState;
+    alignas(64) uint8_t frontIndex;             // Owned by the reader
+};
+
+#endif // TRIPLE_BUFFER_H
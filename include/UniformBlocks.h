@@ -0,0 +1,57 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include "Angel.h"
+
+// CPU mirrors of the std140 uniform blocks declared in vshader.glsl and
+// fshader.glsl. Every program binds each block to the same binding point, so
+// one buffer range per block serves all of them. Field order and padding
+// must match the GLSL declarations exactly.
+
+enum UniformBlockBinding : GLuint {
+    CameraBlockBinding = 0,
+    LightBlockBinding = 1,
+    MaterialBlockBinding = 2
+};
+
+// uniform Camera; matrices are row major, as Angel stores them
+struct CameraBlock {
+    GLfloat view[16];
+    GLfloat projection[16];
+    GLfloat eyePosition[3];
+    GLfloat padding;
+};
+
+// uniform Lighting
+struct LightBlock {
+    GLfloat color[3];
+    GLfloat ambientIntensity;
+    GLfloat direction[3];    // View space
+    GLfloat diffuseIntensity;
+    GLfloat enableAmbient;
+    GLfloat enableDiffuse;
+    GLfloat enableSpecular;
+    GLfloat padding;
+};
+
+// One element of materials[] in uniform Materials; std140 rounds it to 16 bytes
+struct MaterialBlockEntry {
+    GLfloat specularIntensity;
+    GLfloat shininess;
+    GLfloat padding[2];
+};
+
+const int MaxMaterials = 4; // Same as MaxMaterials in the shaders
+
+struct MaterialBlock {
+    MaterialBlockEntry materials[MaxMaterials];
+};
+
+// Points the Camera, Lighting and Materials blocks of program at their binding
+// points; blocks the program does not use are skipped
+void bindUniformBlocks(GLuint program);
+
+// Row-major copy of m for a row_major block member
+void storeMatrix(GLfloat* destination, const mat4& m);
+
+#endif // UNIFORM_BLOCKS_H
@@ -2,6 +2,7 @@
 #define LIGHT_H
 
 #include "Angel.h" 
+#include "UniformBlocks.h"
 
 class Light {
 public:
@@ -10,8 +11,11 @@ public:
     Light(GLfloat red, GLfloat green, GLfloat blue, GLfloat aIntensity,
           GLfloat xDirection, GLfloat yDirection, GLfloat zDirection, GLfloat dIntensity);
 
-    void UseLight(GLfloat ambientIntensityLocation, GLfloat ambientColorLocation,
-                  GLfloat diffuseIntensityLocation, GLfloat directionLocation);
+    // Direction the light travels, in the space the shaders light in (view space)
+    void SetDirection(const vec3& newDirection);
+
+    // Fills the light fields of the Lighting uniform block
+    void WriteBlock(LightBlock& block) const;
 
     ~Light();
 
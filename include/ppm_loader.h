@@ -4,15 +4,19 @@
 #include <string>
 #include <vector>
 
+class JobSystem;
+
 // Structure to hold image data and dimensions
 struct PPMImage {
     int width = 0;
     int height = 0;
-    std::vector<unsigned char> data; // Stores RGB, RGB, RGB...
+    std::vector<unsigned char> data; // Stores RGB, RGB, RGB... (8 bits per channel, grayscale is widened)
     bool isValid = false;            // Flag to indicate if loading was successful
 };
 
-// Function declaration for loading a P3 PPM file
-PPMImage loadPPM(const std::string& filename);
+// Loads a P3 (ASCII), P6 (binary RGB) or P5 (binary grayscale) file.
+// Samples with a maxval other than 255, including 16-bit ones, are rescaled to 8 bits.
+// Large ASCII payloads are decoded in parallel chunks when a job system is given.
+PPMImage loadPPM(const std::string& filename, JobSystem* jobs = nullptr);
 
 #endif // PPM_LOADER_H
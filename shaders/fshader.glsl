@@ -1,4 +1,14 @@
 #version 330 core
+// Variant switches, see vshader.glsl
+#ifndef SHADING_MODE
+#define SHADING_MODE 1
+#endif
+#ifndef TEXTURE_MODE
+#define TEXTURE_MODE 0
+#endif
+#ifndef SHADOW_PASS
+#define SHADOW_PASS 0
+#endif
 
 // Inputs from Vertex Shader
 in vec4 vs_GouraudColor;
@@ -7,46 +17,54 @@ in vec3 vs_ViewNormal;
 in vec4 vs_VertexColor;
 in vec2 vs_TexCoord;    // 2D texture coordinates
 in float vs_TexCoordS;  // 1D texture coordinate (s-component)
+flat in int vs_MaterialIndex;
+flat in float vs_TextureLayer;
 
 out vec4 FragColor;
 
-// --- Uniforms (existing and new) ---
-uniform int shadingMode;     // 0: Gouraud, 1: Phong
-uniform int displayMode;     // From C++: 0 for Shading, 2 for Texture (FS concern)
-
-uniform bool u_isShadowPass; // True if rendering the shadow
 uniform vec4 u_shadowColor;  // The color of the shadow
 
+// --- Uniform blocks shared by every program (std140, see UniformBlocks.h) ---
+layout (std140, row_major) uniform Camera {
+    mat4 View;
+    mat4 Projection;
+    vec3 eyePosition; // Expected in View Space
+};
+
 struct DirectionalLight {
     vec3 color;
     float ambientIntensity;
-    vec3 direction;        // Expected in View Space from C++
+    vec3 direction; // Expected in View Space from C++
     float diffuseIntensity;
 };
-uniform DirectionalLight directionalLight;
+layout (std140) uniform Lighting {
+    DirectionalLight directionalLight;
+    float enableAmbient;
+    float enableDiffuse;
+    float enableSpecular;
+};
 
 struct Material {
     float specularIntensity;
     float shininess;
 };
-uniform Material material;
-
-uniform vec3 eyePosition;    // Expected in View Space
-uniform float enableAmbient;
-uniform float enableDiffuse;
-uniform float enableSpecular;
+const int MaxMaterials = 4;
+layout (std140) uniform Materials {
+    Material materials[MaxMaterials];
+};
 
-// --- Texture Samplers and Type ---
-uniform sampler2D textureSampler2D; // For 2D textures (earth, basketball)
+// --- Texture Samplers ---
+uniform sampler2DArray textureSampler2D; // For 2D textures (earth, basketball), one layer each
 uniform sampler1D textureSampler1D; // For 1D synthetic texture
-uniform int u_currentTextureType;   // 0 for 2D texture, 1 for 1D texture
 
 void main()
 {
-    if (u_isShadowPass) {
-        FragColor = u_shadowColor;
-        return;
-    }
+#if SHADOW_PASS
+    FragColor = u_shadowColor;
+#elif SHADING_MODE == 0 && TEXTURE_MODE == 0
+    FragColor = vs_GouraudColor; // Lit per vertex
+#else
+    Material material = materials[vs_MaterialIndex];
 
     // --- Lighting Calculation Components (common for Phong and lit Texture) ---
     vec3 N_eff = normalize(vs_ViewNormal);
@@ -66,28 +84,23 @@ void main()
     }
 
     // --- Final Color Determination ---
-    if (displayMode == 2) { // Texture Mode (can be 1D or 2D)
-        vec4 baseTexColor;
-        if (u_currentTextureType == 0) { // 2D Texture
-            baseTexColor = texture(textureSampler2D, vs_TexCoord);
-        } else { // 1D Texture (u_currentTextureType == 1)
-            baseTexColor = texture(textureSampler1D, vs_TexCoordS);
-        }
-
-        vec3 baseSurfaceColorFromTexture = baseTexColor.rgb;
-        float finalAlpha = baseTexColor.a * vs_VertexColor.a;
-
-        vec3 litTextureColor = (ambient_light_effect + diffuse_light_effect) * baseSurfaceColorFromTexture;
-        litTextureColor += specular_light_effect;
-        FragColor = vec4(litTextureColor, finalAlpha);
-
-    } else { // MODE_SHADING (0) or MODE_WIREFRAME (shader sees 0 for displayMode)
-        if (shadingMode == 0) { // Gouraud Shading
-            FragColor = vs_GouraudColor;
-        } else { // Phong Shading (shadingMode == 1)
-            vec3 phong_lit_color = (ambient_light_effect + diffuse_light_effect) * vs_VertexColor.rgb;
-            phong_lit_color += specular_light_effect;
-            FragColor = vec4(phong_lit_color, vs_VertexColor.a);
-        }
-    }
+#if TEXTURE_MODE != 0 // Texture Mode (1D or 2D), lit per fragment whatever the shading mode
+#if TEXTURE_MODE == 1
+    vec4 baseTexColor = texture(textureSampler2D, vec3(vs_TexCoord, vs_TextureLayer));
+#else
+    vec4 baseTexColor = texture(textureSampler1D, vs_TexCoordS);
+#endif
+
+    vec3 baseSurfaceColorFromTexture = baseTexColor.rgb;
+    float finalAlpha = baseTexColor.a * vs_VertexColor.a;
+
+    vec3 litTextureColor = (ambient_light_effect + diffuse_light_effect) * baseSurfaceColorFromTexture;
+    litTextureColor += specular_light_effect;
+    FragColor = vec4(litTextureColor, finalAlpha);
+#else // Phong Shading
+    vec3 phong_lit_color = (ambient_light_effect + diffuse_light_effect) * vs_VertexColor.rgb;
+    phong_lit_color += specular_light_effect;
+    FragColor = vec4(phong_lit_color, vs_VertexColor.a);
+#endif
+#endif
 }
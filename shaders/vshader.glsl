@@ -1,38 +1,62 @@
 #version 330 core
+// Variant switches, defined by ShaderVariants after the #version line:
+//   SHADING_MODE  0: Gouraud, 1: Phong
+//   TEXTURE_MODE  0: none (shading only), 1: 2D texture array, 2: 1D stripe texture
+//   SHADOW_PASS   1: projected shadow, flat colour
+// The defaults below build the plain Phong variant.
+#ifndef SHADING_MODE
+#define SHADING_MODE 1
+#endif
+#ifndef TEXTURE_MODE
+#define TEXTURE_MODE 0
+#endif
+#ifndef SHADOW_PASS
+#define SHADOW_PASS 0
+#endif
+
 layout (location = 0) in vec4 vPosition;
 layout (location = 1) in vec4 vColor;
 layout (location = 2) in vec3 vNormal;
 layout (location = 3) in vec2 aTexCoord; // Existing 2D texture coordinates
 
-uniform mat4 ModelView;
-uniform mat4 Projection;
-uniform int shadingMode; // 0: Gouraud, 1: Phong
+// Per-instance attributes (divisor 1), see SphereInstances.h
+layout (location = 4) in mat4 iModelMatrix;   // Object's model matrix (world transformation), locations 4-7
+layout (location = 8) in vec2 iMaterialLayer; // x: index into materials[], y: texture array layer
+
+uniform mat4 u_ShadowMatrix; // Projects onto the floor in the shadow pass, identity otherwise
+
+// --- Uniform blocks shared by every program (std140, see UniformBlocks.h) ---
+layout (std140, row_major) uniform Camera {
+    mat4 View;
+    mat4 Projection;
+    vec3 eyePosition; // Expected in View Space
+};
 
-// --- Uniforms for Lighting (existing) ---
 struct DirectionalLight {
     vec3 color;
     float ambientIntensity;
     vec3 direction; // Expected in View Space from C++
     float diffuseIntensity;
 };
-uniform DirectionalLight directionalLight;
+layout (std140) uniform Lighting {
+    DirectionalLight directionalLight;
+    float enableAmbient;
+    float enableDiffuse;
+    float enableSpecular;
+};
 
 struct Material {
     float specularIntensity;
     float shininess;
 };
-uniform Material material;
-
-uniform vec3 eyePosition; // Expected in View Space
-uniform float enableAmbient;
-uniform float enableDiffuse;
-uniform float enableSpecular;
+const int MaxMaterials = 4;
+layout (std140) uniform Materials {
+    Material materials[MaxMaterials];
+};
 
 // --- NEW Uniforms for 1D Texture Mapping ---
-uniform mat4 u_ModelMatrix;           // Object's model matrix (world transformation)
 uniform vec4 u_1DTexturePlane;        // Plane for 1D tex coords (Nx, Ny, Nz, D) in World Space
 uniform float u_1DTextureStripeScale; // Scale factor for 1D texture stripe frequency
-uniform int u_currentTextureType;     // 0 for 2D texture, 1 for 1D texture
 
 // --- Outputs to Fragment Shader ---
 out vec4 vs_GouraudColor; // For Gouraud result
@@ -41,30 +65,37 @@ out vec3 vs_ViewNormal;   // For Phong
 out vec4 vs_VertexColor;  // For Phong (and Gouraud base)
 out vec2 vs_TexCoord;     // Pass through 2D tex coords
 out float vs_TexCoordS;   // Calculated 1D tex coord (s-component)
+flat out int vs_MaterialIndex;
+flat out float vs_TextureLayer;
 
 void main()
 {
+    mat4 ModelView = View * u_ShadowMatrix * iModelMatrix;
     vec4 P_view_h = ModelView * vPosition; // Vertex position in View Space
 
     vs_ViewPos = P_view_h.xyz;
     vs_ViewNormal = normalize(mat3(ModelView) * vNormal); // Normal in View Space
     vs_VertexColor = vColor;
     vs_TexCoord = aTexCoord; // Pass through 2D texture coordinates
+    vs_MaterialIndex = int(iMaterialLayer.x);
+    vs_TextureLayer = iMaterialLayer.y;
 
-    // Calculate 1D texture coordinate if 1D texture is active
-    if (u_currentTextureType == 1) { // 1D Texture is active
-        vec4 worldPos = u_ModelMatrix * vPosition; // Vertex position in World Space
+#if TEXTURE_MODE == 2
+    // 1D texture coordinate
+    vec4 worldPos = iModelMatrix * vPosition; // Vertex position in World Space
 
-        // Calculate signed distance to the plane (assuming u_1DTexturePlane.xyz is normalized)
-        // Plane equation: dot(N, P) + D = 0. Distance = dot(N,P) + D
-        float distanceToPlane = dot(worldPos.xyz, u_1DTexturePlane.xyz) + u_1DTexturePlane.w;
-        vs_TexCoordS = distanceToPlane * u_1DTextureStripeScale;
-    } else {
-        vs_TexCoordS = 0.0; // Default, not used by 2D texturing path in FS
-    }
+    // Calculate signed distance to the plane (assuming u_1DTexturePlane.xyz is normalized)
+    // Plane equation: dot(N, P) + D = 0. Distance = dot(N,P) + D
+    float distanceToPlane = dot(worldPos.xyz, u_1DTexturePlane.xyz) + u_1DTexturePlane.w;
+    vs_TexCoordS = distanceToPlane * u_1DTextureStripeScale;
+#else
+    vs_TexCoordS = 0.0; // Not used by the other variants
+#endif
 
+#if SHADING_MODE == 0 && TEXTURE_MODE == 0 && SHADOW_PASS == 0
     // Gouraud Shading Path (existing logic)
-    if (shadingMode == 0) {
+    {
+        Material material = materials[int(iMaterialLayer.x)];
         vec3 N = vs_ViewNormal;
         vec3 V = normalize(eyePosition - vs_ViewPos); // eyePosition is already in view space
         vec3 L_to_light = normalize(-directionalLight.direction); // light.direction is already in view space
@@ -93,9 +124,10 @@ void main()
         vec3 finalSpecular = specular_calc * enableSpecular;
         vec3 totalLight = finalAmbient + finalDiffuse + finalSpecular;
         vs_GouraudColor = vec4(totalLight * vs_VertexColor.rgb, vs_VertexColor.a);
-    } else { // Phong Shading Path
-        vs_GouraudColor = vec4(0.0, 0.0, 0.0, 1.0); // Default for this out, FS Phong path ignores it
     }
+#else
+    vs_GouraudColor = vec4(0.0, 0.0, 0.0, 1.0); // Lighting happens per fragment (or not at all) in this variant
+#endif
 
     gl_Position = Projection * P_view_h;
 }
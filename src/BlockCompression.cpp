@@ -0,0 +1,351 @@
+#include "BlockCompression.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(SPHERE_HAS_SSE)
+    #include <emmintrin.h>
+#endif
+
+namespace {
+
+// Block rows handled by one job
+const size_t blockRowGrainSize = 4;
+
+// BC7 4-bit index interpolation weights (out of 64)
+const int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// 16 texels stored channel by channel so four texels fit one SSE register
+struct Block {
+    float r[16], g[16], b[16];
+};
+
+struct Palette {
+    int size;
+    float r[16], g[16], b[16];
+};
+
+// Texels outside the image (partial edge blocks) repeat the last row/column
+void loadBlock(const unsigned char* rgb, int width, int height, int bx, int by, Block& block) {
+    for (int y = 0; y < 4; ++y) {
+        int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+        for (int x = 0; x < 4; ++x) {
+            int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+            const unsigned char* p = rgb + ((size_t)sy * width + sx) * 3;
+            block.r[y * 4 + x] = p[0];
+            block.g[y * 4 + x] = p[1];
+            block.b[y * 4 + x] = p[2];
+        }
+    }
+}
+
+inline float clampColor(float v) {
+    return v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v);
+}
+
+// Endpoints at the extremes of the block projected on its principal axis
+void findEndpoints(const Block& block, float lo[3], float hi[3]) {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i) {
+        mean[0] += block.r[i]; mean[1] += block.g[i]; mean[2] += block.b[i];
+    }
+    for (int c = 0; c < 3; ++c) mean[c] /= 16.0f;
+
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; ++i) {
+        float dr = block.r[i] - mean[0], dg = block.g[i] - mean[1], db = block.b[i] - mean[2];
+        cov[0] += dr * dr; cov[1] += dr * dg; cov[2] += dr * db;
+        cov[3] += dg * dg; cov[4] += dg * db; cov[5] += db * db;
+    }
+
+    // Power iteration for the dominant eigenvector
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::sqrt(x * x + y * y + z * z);
+        if (length < 1e-6f) break; // Flat block, any axis will do
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float t = (block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1] + (block.b[i] - mean[2]) * axis[2];
+        if (t < tMin) tMin = t;
+        if (t > tMax) tMax = t;
+    }
+    for (int c = 0; c < 3; ++c) {
+        lo[c] = clampColor(mean[c] + tMin * axis[c]);
+        hi[c] = clampColor(mean[c] + tMax * axis[c]);
+    }
+}
+
+// Picks the nearest palette entry for every texel and returns the total squared error
+float selectIndices(const Block& block, const Palette& palette, unsigned char indices[16]) {
+#if defined(SPHERE_HAS_SSE)
+    __m128 total = _mm_setzero_ps();
+    for (int i = 0; i < 16; i += 4) {
+        __m128 r = _mm_loadu_ps(block.r + i), g = _mm_loadu_ps(block.g + i), b = _mm_loadu_ps(block.b + i);
+        __m128 best = _mm_set1_ps(1e30f);
+        __m128 bestIndex = _mm_setzero_ps();
+        for (int k = 0; k < palette.size; ++k) {
+            __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette.r[k]));
+            __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette.g[k]));
+            __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette.b[k]));
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            __m128 closer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)k)), _mm_andnot_ps(closer, bestIndex));
+        }
+        total = _mm_add_ps(total, best);
+        float lanes[4];
+        _mm_storeu_ps(lanes, bestIndex);
+        for (int l = 0; l < 4; ++l) indices[i + l] = (unsigned char)lanes[l];
+    }
+    float sums[4];
+    _mm_storeu_ps(sums, total);
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#else
+    float total = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float best = 1e30f;
+        int bestIndex = 0;
+        for (int k = 0; k < palette.size; ++k) {
+            float dr = block.r[i] - palette.r[k], dg = block.g[i] - palette.g[k], db = block.b[i] - palette.b[k];
+            float d = dr * dr + dg * dg + db * db;
+            if (d < best) { best = d; bestIndex = k; }
+        }
+        indices[i] = (unsigned char)bestIndex;
+        total += best;
+    }
+    return total;
+#endif
+}
+
+// Least-squares endpoints for fixed indices; weights[k] is how far palette
+// entry k lies from e0 towards e1. Returns false when the system is singular.
+bool refitEndpoints(const Block& block, const unsigned char indices[16], const float* weights, float e0[3], float e1[3]) {
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float x0[3] = { 0.0f, 0.0f, 0.0f }, x1[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i) {
+        float w = weights[indices[i]];
+        float v = 1.0f - w;
+        a += v * v; b += v * w; c += w * w;
+        x0[0] += v * block.r[i]; x0[1] += v * block.g[i]; x0[2] += v * block.b[i];
+        x1[0] += w * block.r[i]; x1[1] += w * block.g[i]; x1[2] += w * block.b[i];
+    }
+    float det = a * c - b * b;
+    if (std::fabs(det) < 1e-6f) return false;
+    for (int ch = 0; ch < 3; ++ch) {
+        e0[ch] = clampColor((c * x0[ch] - b * x1[ch]) / det);
+        e1[ch] = clampColor((a * x1[ch] - b * x0[ch]) / det);
+    }
+    return true;
+}
+
+// --- BC1 ---------------------------------------------------------------------
+
+uint16_t quantize565(const float c[3]) {
+    int r = (int)(c[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(c[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void expand565(uint16_t v, float c[3]) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (float)((r << 3) | (r >> 2));
+    c[1] = (float)((g << 2) | (g >> 4));
+    c[2] = (float)((b << 3) | (b >> 2));
+}
+
+void encodeBC1Block(const Block& block, unsigned char* out) {
+    static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    float e0[3], e1[3];
+    findEndpoints(block, e1, e0);
+
+    float bestError = 1e30f;
+    uint16_t bestC0 = 0, bestC1 = 0;
+    unsigned char bestIndices[16] = {};
+
+    // Principal-axis endpoints, then one least-squares refinement
+    for (int pass = 0; pass < 2; ++pass) {
+        uint16_t c0 = quantize565(e0), c1 = quantize565(e1);
+        if (c0 < c1) { uint16_t t = c0; c0 = c1; c1 = t; } // c0 > c1 selects the four-colour mode
+
+        Palette palette;
+        float p0[3], p1[3];
+        expand565(c0, p0);
+        expand565(c1, p1);
+        palette.size = c0 == c1 ? 1 : 4;
+        for (int k = 0; k < 4; ++k) {
+            palette.r[k] = p0[0] + (p1[0] - p0[0]) * weights[k];
+            palette.g[k] = p0[1] + (p1[1] - p0[1]) * weights[k];
+            palette.b[k] = p0[2] + (p1[2] - p0[2]) * weights[k];
+        }
+
+        unsigned char indices[16];
+        float error = selectIndices(block, palette, indices);
+        if (error < bestError) {
+            bestError = error;
+            bestC0 = c0;
+            bestC1 = c1;
+            std::memcpy(bestIndices, indices, 16);
+        }
+        if (palette.size == 1 || !refitEndpoints(block, indices, weights, e0, e1)) break;
+    }
+
+    uint32_t packed = 0;
+    for (int i = 0; i < 16; ++i) packed |= (uint32_t)bestIndices[i] << (2 * i);
+    out[0] = (unsigned char)(bestC0 & 0xFF); out[1] = (unsigned char)(bestC0 >> 8);
+    out[2] = (unsigned char)(bestC1 & 0xFF); out[3] = (unsigned char)(bestC1 >> 8);
+    for (int i = 0; i < 4; ++i) out[4 + i] = (unsigned char)(packed >> (8 * i));
+}
+
+// --- BC7 (mode 6: one subset, 7-bit RGBA endpoints with a p-bit each, 4-bit indices) ---
+
+struct BitWriter {
+    unsigned char* out;
+    int position;
+    void write(uint32_t value, int bits) {
+        for (int i = 0; i < bits; ++i, ++position) {
+            if ((value >> i) & 1) out[position >> 3] |= (unsigned char)(1 << (position & 7));
+        }
+    }
+};
+
+// 7-bit endpoint for channel value v with the given p-bit; decodes to q * 2 + p
+inline int quantizeWithPBit(float v, int p) {
+    int q = (int)((v - p) * 0.5f + 0.5f);
+    return q < 0 ? 0 : (q > 127 ? 127 : q);
+}
+
+void encodeBC7Block(const Block& block, unsigned char* out) {
+    static const float weights[16] = {
+        0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+        34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f
+    };
+
+    float e0[3], e1[3];
+    findEndpoints(block, e0, e1);
+
+    float bestError = 1e30f;
+    int bestQ0[3] = {}, bestQ1[3] = {}, bestP0 = 1, bestP1 = 1;
+    unsigned char bestIndices[16] = {};
+
+    for (int pass = 0; pass < 2; ++pass) {
+        // Every p-bit combination gives a slightly different endpoint lattice
+        unsigned char passIndices[16] = {};
+        float passError = 1e30f;
+        for (int pbits = 0; pbits < 4; ++pbits) {
+            int p0 = pbits & 1, p1 = pbits >> 1;
+            int q0[3], q1[3];
+            float d0[3], d1[3];
+            for (int c = 0; c < 3; ++c) {
+                q0[c] = quantizeWithPBit(e0[c], p0);
+                q1[c] = quantizeWithPBit(e1[c], p1);
+                d0[c] = (float)(q0[c] * 2 + p0);
+                d1[c] = (float)(q1[c] * 2 + p1);
+            }
+
+            Palette palette;
+            palette.size = 16;
+            for (int k = 0; k < 16; ++k) {
+                int w = bc7Weights4[k];
+                palette.r[k] = (float)(((int)d0[0] * (64 - w) + (int)d1[0] * w + 32) >> 6);
+                palette.g[k] = (float)(((int)d0[1] * (64 - w) + (int)d1[1] * w + 32) >> 6);
+                palette.b[k] = (float)(((int)d0[2] * (64 - w) + (int)d1[2] * w + 32) >> 6);
+            }
+
+            unsigned char indices[16];
+            float error = selectIndices(block, palette, indices);
+            if (error < passError) {
+                passError = error;
+                std::memcpy(passIndices, indices, 16);
+            }
+            if (error < bestError) {
+                bestError = error;
+                for (int c = 0; c < 3; ++c) { bestQ0[c] = q0[c]; bestQ1[c] = q1[c]; }
+                bestP0 = p0;
+                bestP1 = p1;
+                std::memcpy(bestIndices, indices, 16);
+            }
+        }
+        if (!refitEndpoints(block, passIndices, weights, e0, e1)) break;
+    }
+
+    // The anchor (first) index is stored without its top bit, so it must be < 8
+    if (bestIndices[0] >= 8) {
+        for (int c = 0; c < 3; ++c) { int t = bestQ0[c]; bestQ0[c] = bestQ1[c]; bestQ1[c] = t; }
+        int t = bestP0; bestP0 = bestP1; bestP1 = t;
+        for (int i = 0; i < 16; ++i) bestIndices[i] = (unsigned char)(15 - bestIndices[i]);
+    }
+
+    // Alpha endpoints are 127 so texels decode to 254 or 255 depending on
+    // the p-bits; the textures are sampled as opaque RGB either way
+    std::memset(out, 0, 16);
+    BitWriter writer = { out, 0 };
+    writer.write(1u << 6, 7); // Mode 6
+    for (int c = 0; c < 3; ++c) {
+        writer.write((uint32_t)bestQ0[c], 7);
+        writer.write((uint32_t)bestQ1[c], 7);
+    }
+    writer.write(127, 7);
+    writer.write(127, 7);
+    writer.write((uint32_t)bestP0, 1);
+    writer.write((uint32_t)bestP1, 1);
+    writer.write(bestIndices[0], 3);
+    for (int i = 1; i < 16; ++i) writer.write(bestIndices[i], 4);
+}
+
+} // namespace
+
+const char* textureFormatName(TextureFormat format)
+{
+    switch (format) {
+    case TextureFormat::BC1: return "BC1";
+    case TextureFormat::BC7: return "BC7";
+    default: return "RGB8";
+    }
+}
+
+size_t compressedLevelSize(int width, int height, TextureFormat format)
+{
+    if (format == TextureFormat::RGB8) return (size_t)width * height * 3;
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * (format == TextureFormat::BC1 ? 8 : 16);
+}
+
+void compressImage(const unsigned char* rgb, int width, int height, TextureFormat format,
+                   std::vector<unsigned char>& out, JobSystem* jobs)
+{
+    out.assign(compressedLevelSize(width, height, format), 0);
+    if (format == TextureFormat::RGB8) {
+        std::memcpy(out.data(), rgb, out.size());
+        return;
+    }
+
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+    const size_t blockBytes = format == TextureFormat::BC1 ? 8 : 16;
+
+    // Blocks are independent, so rows of blocks are independent jobs
+    auto encodeRows = [&](size_t rowBegin, size_t rowEnd) {
+        Block block;
+        for (size_t by = rowBegin; by < rowEnd; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                loadBlock(rgb, width, height, bx, (int)by, block);
+                unsigned char* dst = &out[(by * blocksX + bx) * blockBytes];
+                if (format == TextureFormat::BC1) encodeBC1Block(block, dst);
+                else encodeBC7Block(block, dst);
+            }
+        }
+    };
+    if (jobs == nullptr) encodeRows(0, (size_t)blocksY);
+    else jobs->parallelFor(0, (size_t)blocksY, blockRowGrainSize, encodeRows);
+}
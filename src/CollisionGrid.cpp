@@ -0,0 +1,165 @@
+#include "CollisionGrid.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+// Bodies per job when searching for pairs in parallel
+static const size_t pairGrainSize = 4096;
+
+CollisionGrid::CollisionGrid()
+{
+    cellSize = 0.0f;
+    invCellSize = 0.0f;
+    tableMask = 0;
+    bodyCount = 0;
+    rebinnedCount = 0;
+    stamp = 0;
+}
+
+void CollisionGrid::cellOf(float px, float py, float pz, int& ix, int& iy, int& iz) const
+{
+    ix = (int)std::floor(px * invCellSize);
+    iy = (int)std::floor(py * invCellSize);
+    iz = (int)std::floor(pz * invCellSize);
+}
+
+uint32_t CollisionGrid::hashCell(int ix, int iy, int iz) const
+{
+    uint32_t h = ((uint32_t)ix * 73856093u) ^ ((uint32_t)iy * 19349663u) ^ ((uint32_t)iz * 83492791u);
+    return h & tableMask;
+}
+
+void CollisionGrid::update(const float* x, const float* y, const float* z, size_t count, float newCellSize)
+{
+    // Two buckets per body keeps most buckets holding a single cell
+    size_t tableSize = 64;
+    while (tableSize < count * 2) tableSize *= 2;
+
+    bool rebuild = count != bodyCount || newCellSize != cellSize || tableSize != bucketStart.size();
+    if (rebuild) {
+        cellSize = newCellSize;
+        invCellSize = 1.0f / newCellSize;
+        tableMask = (uint32_t)(tableSize - 1);
+        bodyCount = count;
+        bodyBucket.assign(count, 0);
+        sortedBodies.clear();
+        bucketStart.assign(tableSize, 0);
+        bucketEnd.assign(tableSize, 0);
+        bucketStamp.assign(tableSize, 0);
+        stamp = 0;
+    }
+
+    rebinnedCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int ix, iy, iz;
+        cellOf(x[i], y[i], z[i], ix, iy, iz);
+        uint32_t bucket = hashCell(ix, iy, iz);
+        if (bucket != bodyBucket[i]) {
+            bodyBucket[i] = bucket;
+            ++rebinnedCount;
+        }
+    }
+    if (rebuild) rebinnedCount = count;
+
+    // Nobody changed bucket, so last step's bins are still valid
+    if (rebinnedCount == 0) return;
+
+    countingSort();
+    buildBucketRanges();
+}
+
+void CollisionGrid::countingSort()
+{
+    // Histogram of bucket sizes, then a prefix sum gives every bucket its first slot
+    std::vector<uint32_t>& offsets = sortScratch;
+    offsets.assign(tableMask + 2, 0);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        ++offsets[bodyBucket[i] + 1];
+    }
+    for (size_t b = 1; b < offsets.size(); ++b) {
+        offsets[b] += offsets[b - 1];
+    }
+
+    sortedBodies.resize(bodyCount);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        sortedBodies[offsets[bodyBucket[i]]++] = (uint32_t)i;
+    }
+}
+
+void CollisionGrid::buildBucketRanges()
+{
+    // Stamping buckets avoids clearing the whole table every step
+    if (++stamp == 0) {
+        std::fill(bucketStamp.begin(), bucketStamp.end(), 0);
+        stamp = 1;
+    }
+
+    for (size_t s = 0; s < sortedBodies.size(); ++s) {
+        uint32_t bucket = bodyBucket[sortedBodies[s]];
+        if (bucketStamp[bucket] != stamp) {
+            bucketStamp[bucket] = stamp;
+            bucketStart[bucket] = (uint32_t)s;
+        }
+        bucketEnd[bucket] = (uint32_t)s + 1;
+    }
+}
+
+void CollisionGrid::findPairs(const float* x, const float* y, const float* z, const float* radius,
+                              std::vector<ContactPair>& pairs, JobSystem* jobs)
+{
+    pairs.clear();
+    if (bodyCount < 2) return;
+
+    if (jobs == nullptr || bodyCount <= pairGrainSize) {
+        findPairsRange(0, bodyCount, x, y, z, radius, pairs);
+        return;
+    }
+
+    // Every chunk writes its own list; concatenating them in chunk order keeps
+    // the pair order (and so the solver result) independent of scheduling
+    size_t chunkCount = (bodyCount + pairGrainSize - 1) / pairGrainSize;
+    chunkPairs.resize(chunkCount);
+    jobs->parallelFor(0, bodyCount, pairGrainSize, [&](size_t begin, size_t end) {
+        std::vector<ContactPair>& out = chunkPairs[begin / pairGrainSize];
+        out.clear();
+        findPairsRange(begin, end, x, y, z, radius, out);
+    });
+    for (size_t c = 0; c < chunkCount; ++c) {
+        pairs.insert(pairs.end(), chunkPairs[c].begin(), chunkPairs[c].end());
+    }
+}
+
+void CollisionGrid::findPairsRange(size_t begin, size_t end, const float* x, const float* y, const float* z,
+                                   const float* radius, std::vector<ContactPair>& out) const
+{
+    for (size_t s = begin; s < end; ++s) {
+        uint32_t a = sortedBodies[s];
+        int ix, iy, iz;
+        cellOf(x[a], y[a], z[a], ix, iy, iz);
+
+        // Neighbouring cells can hash to the same bucket; visit each bucket once
+        uint32_t visited[27];
+        int visitedCount = 0;
+        for (int dx = -1; dx <= 1; ++dx)
+        for (int dy = -1; dy <= 1; ++dy)
+        for (int dz = -1; dz <= 1; ++dz) {
+            uint32_t bucket = hashCell(ix + dx, iy + dy, iz + dz);
+            if (bucketStamp[bucket] != stamp) continue;
+            if (std::find(visited, visited + visitedCount, bucket) != visited + visitedCount) continue;
+            visited[visitedCount++] = bucket;
+
+            for (uint32_t t = bucketStart[bucket]; t < bucketEnd[bucket]; ++t) {
+                uint32_t b = sortedBodies[t];
+                if (b <= a) continue; // Each pair is reported from its lower index only
+
+                float ddx = x[b] - x[a];
+                float ddy = y[b] - y[a];
+                float ddz = z[b] - z[a];
+                float reach = radius[a] + radius[b];
+                if (ddx * ddx + ddy * ddy + ddz * ddz < reach * reach) {
+                    out.push_back(ContactPair{ a, b });
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && defined(SPHERE_HAS_SSE)
+    #include <intrin.h>
+    #include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(SPHERE_HAS_AVX2)
+static bool queryAVX2()
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // The OS must save the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+#endif
+
+bool cpuHasSSE2()
+{
+#if defined(SPHERE_HAS_SSE)
+    // SSE2 is part of the x86-64 baseline and required by our 32-bit builds
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool cpuHasAVX2()
+{
+#if defined(SPHERE_HAS_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    return hasAVX2;
+#elif defined(SPHERE_HAS_AVX2) && defined(_MSC_VER)
+    static const bool hasAVX2 = queryAVX2();
+    return hasAVX2;
+#else
+    return false;
+#endif
+}
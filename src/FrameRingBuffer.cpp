@@ -0,0 +1,120 @@
+#include "FrameRingBuffer.h"
+
+FrameRingBuffer::FrameRingBuffer()
+{
+    buffer = 0;
+    segmentSize = 0;
+    segment = 0;
+    head = 0;
+    persistentData = nullptr;
+    for (int i = 0; i < segmentCount; ++i) fences[i] = nullptr;
+}
+
+void FrameRingBuffer::init(size_t segmentBytes)
+{
+    createStorage(segmentBytes);
+}
+
+void FrameRingBuffer::destroy()
+{
+    releaseStorage();
+    segmentSize = 0;
+    shadow.clear();
+}
+
+void FrameRingBuffer::beginFrame(size_t minimumBytes)
+{
+    if (minimumBytes > segmentSize) {
+        size_t grown = segmentSize > 0 ? segmentSize * 2 : minimumBytes;
+        while (grown < minimumBytes) grown *= 2;
+        releaseStorage();
+        createStorage(grown);
+    }
+
+    segment = (segment + 1) % segmentCount;
+    head = 0;
+
+    GLsync& fence = fences[segment];
+    if (fence) {
+        // Normally signalled long ago; blocks only when the GPU is a full ring behind
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void* FrameRingBuffer::allocate(size_t bytes, size_t alignment, size_t& offset)
+{
+    size_t start = (head + alignment - 1) / alignment * alignment;
+    if (start + bytes > segmentSize) return nullptr;
+    head = start + bytes;
+
+    if (persistentData) {
+        offset = (size_t)segment * segmentSize + start;
+        return persistentData + offset;
+    }
+    offset = start;
+    return shadow.data() + start;
+}
+
+void FrameRingBuffer::flush()
+{
+    if (persistentData || head == 0) return;
+
+    // Orphan the storage earlier frames may still be reading and refill it
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)segmentSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)head, shadow.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void FrameRingBuffer::endFrame()
+{
+    if (persistentData) fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FrameRingBuffer::createStorage(size_t segmentBytes)
+{
+    segmentSize = (segmentBytes + 255) & ~size_t(255); // Keeps every segment aligned for any binding
+    segment = 0;
+    head = 0;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = (GLsizeiptr)(segmentSize * segmentCount);
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        persistentData = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (!persistentData) {
+            // Immutable storage cannot be orphaned; start over with a mutable buffer
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        }
+    }
+    if (!persistentData) {
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)segmentSize, nullptr, GL_STREAM_DRAW);
+        shadow.resize(segmentSize);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void FrameRingBuffer::releaseStorage()
+{
+    for (int i = 0; i < segmentCount; ++i) {
+        if (!fences[i]) continue;
+        while (glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fences[i]);
+        fences[i] = nullptr;
+    }
+    if (buffer == 0) return;
+    if (persistentData) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        persistentData = nullptr;
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
@@ -0,0 +1,170 @@
+#include "GLStateCache.h"
+#include <cstring>
+
+GLStateCache::GLStateCache()
+{
+    invalidate();
+    resetStats();
+}
+
+void GLStateCache::invalidate()
+{
+    program = 0;
+    programKnown = false;
+    vao = 0;
+    vaoKnown = false;
+    invalidateTextures();
+    capabilities.clear();
+    depthFuncValue = 0;
+    depthMaskValue = -1;
+    blendSource = blendDestination = 0;
+    polygonModeValue = 0;
+    uniforms.clear();
+    currentUniforms = nullptr;
+}
+
+void GLStateCache::invalidateTextures()
+{
+    activeUnit = -1;
+    textures.clear();
+}
+
+void GLStateCache::resetStats()
+{
+    stats.issued = 0;
+    stats.elided = 0;
+}
+
+bool GLStateCache::count(bool changed)
+{
+    if (changed) ++stats.issued;
+    else ++stats.elided;
+    return changed;
+}
+
+void GLStateCache::useProgram(GLuint newProgram)
+{
+    if (!count(!programKnown || program != newProgram)) return;
+    glUseProgram(newProgram);
+    program = newProgram;
+    programKnown = true;
+    currentUniforms = &uniforms[newProgram];
+}
+
+void GLStateCache::bindVertexArray(GLuint newVao)
+{
+    if (!count(!vaoKnown || vao != newVao)) return;
+    glBindVertexArray(newVao);
+    vao = newVao;
+    vaoKnown = true;
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    TextureBinding* binding = nullptr;
+    for (size_t i = 0; i < textures.size() && !binding; ++i) {
+        if (textures[i].unit == unit && textures[i].target == target) binding = &textures[i];
+    }
+    if (binding && binding->texture == texture) {
+        count(false);
+        return;
+    }
+    if (activeUnit != (GLint)unit) {
+        count(true);
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = (GLint)unit;
+    }
+    count(true);
+    glBindTexture(target, texture);
+    if (binding) binding->texture = texture;
+    else textures.push_back(TextureBinding{ unit, target, texture });
+}
+
+void GLStateCache::setCapability(GLenum capability, bool enabled)
+{
+    CapabilityState* state = nullptr;
+    for (size_t i = 0; i < capabilities.size() && !state; ++i) {
+        if (capabilities[i].capability == capability) state = &capabilities[i];
+    }
+    if (!count(!state || state->enabled != enabled)) return;
+    if (enabled) glEnable(capability);
+    else glDisable(capability);
+    if (state) state->enabled = enabled;
+    else capabilities.push_back(CapabilityState{ capability, enabled });
+}
+
+void GLStateCache::depthFunc(GLenum func)
+{
+    if (!count(depthFuncValue != func)) return;
+    glDepthFunc(func);
+    depthFuncValue = func;
+}
+
+void GLStateCache::depthMask(GLboolean mask)
+{
+    if (!count(depthMaskValue != (GLint)mask)) return;
+    glDepthMask(mask);
+    depthMaskValue = mask;
+}
+
+void GLStateCache::blendFunc(GLenum source, GLenum destination)
+{
+    if (!count(blendSource != source || blendDestination != destination)) return;
+    glBlendFunc(source, destination);
+    blendSource = source;
+    blendDestination = destination;
+}
+
+void GLStateCache::polygonMode(GLenum mode)
+{
+    if (!count(polygonModeValue != mode)) return;
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    polygonModeValue = mode;
+}
+
+bool GLStateCache::changeUniform(GLint location, GLenum type, const void* data, size_t size)
+{
+    if (!currentUniforms) return true; // Program unknown; nothing to compare against
+    if ((size_t)location >= currentUniforms->size()) {
+        UniformValue unknown = UniformValue();
+        currentUniforms->resize((size_t)location + 1, unknown);
+    }
+    UniformValue& value = (*currentUniforms)[location];
+    if (value.type == type && memcmp(value.data, data, size) == 0) return false;
+    value.type = type;
+    memcpy(value.data, data, size);
+    return true;
+}
+
+void GLStateCache::uniform1i(GLint location, GLint value)
+{
+    if (location < 0) return;
+    if (!count(changeUniform(location, GL_INT, &value, sizeof(value)))) return;
+    glUniform1i(location, value);
+}
+
+void GLStateCache::uniform1f(GLint location, GLfloat value)
+{
+    if (location < 0) return;
+    if (!count(changeUniform(location, GL_FLOAT, &value, sizeof(value)))) return;
+    glUniform1f(location, value);
+}
+
+void GLStateCache::uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+    if (location < 0) return;
+    const GLfloat value[4] = { x, y, z, w };
+    if (!count(changeUniform(location, GL_FLOAT_VEC4, value, sizeof(value)))) return;
+    glUniform4fv(location, 1, value);
+}
+
+void GLStateCache::uniformMatrix4(GLint location, const mat4& m)
+{
+    if (location < 0) return;
+    GLfloat value[16];
+    for (int row = 0; row < 4; ++row) {
+        for (int column = 0; column < 4; ++column) value[row * 4 + column] = m[row][column];
+    }
+    if (!count(changeUniform(location, GL_FLOAT_MAT4, value, sizeof(value)))) return;
+    glUniformMatrix4fv(location, 1, GL_TRUE, value);
+}
@@ -1,5 +1,7 @@
 
 #include "Angel.h"
+#include "ProgramCache.h"
+#include <cstring>
 
 namespace Angel {
 
@@ -28,6 +30,17 @@ readShaderSource(const char* shaderFile)
 // Create a GLSL program object from vertex and fragment shader files
 GLuint
 InitShader(const char* vShaderFile, const char* fShaderFile)
+{
+    return InitShader( vShaderFile, fShaderFile, "" );
+}
+
+
+// Create a GLSL program object from vertex and fragment shader files, with
+// definitions compiled in after the #version line (which must come first).
+// A binary of the linked program is cached on disk (see ProgramCache.h), so
+// later runs with the same sources and driver skip compiling and linking.
+GLuint
+InitShader(const char* vShaderFile, const char* fShaderFile, const char* definitions, bool* fromCache)
 {
     struct Shader {
 	const char*  filename;
@@ -38,8 +51,7 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	{ fShaderFile, GL_FRAGMENT_SHADER, NULL }
     };
 
-    GLuint program = glCreateProgram();
-    
+    uint64_t sourceHash = hashShaderText( definitions, strlen( definitions ) );
     for ( int i = 0; i < 2; ++i ) {
 	Shader& s = shaders[i];
 	s.source = readShaderSource( s.filename );
@@ -47,9 +59,38 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	    std::cerr << "Failed to read " << s.filename << std::endl;
 	    exit( EXIT_FAILURE );
 	}
+	sourceHash = hashShaderText( s.source, strlen( s.source ) + 1, sourceHash );
+    }
+
+    const std::string cachePath = programCachePath( vShaderFile, fShaderFile, definitions );
+    GLuint program = loadProgramBinary( cachePath, sourceHash );
+    if ( fromCache ) *fromCache = program != 0;
+    if ( program != 0 ) {
+	delete [] shaders[0].source;
+	delete [] shaders[1].source;
+	glUseProgram( program );
+	return program;
+    }
+
+    program = glCreateProgram();
+    if ( programBinariesSupported() ) {
+	glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+    }
+    
+    for ( int i = 0; i < 2; ++i ) {
+	Shader& s = shaders[i];
+
+	// Split after the #version line so the definitions follow it
+	const GLchar* body = s.source;
+	if ( strncmp( body, "#version", 8 ) == 0 ) {
+	    const GLchar* lineEnd = strchr( body, '\n' );
+	    body = lineEnd ? lineEnd + 1 : body + strlen( body );
+	}
+	const GLchar* parts[3] = { s.source, definitions, body };
+	GLint lengths[3] = { (GLint)( body - s.source ), (GLint) strlen( definitions ), -1 };
 
 	GLuint shader = glCreateShader( s.type );
-	glShaderSource( shader, 1, (const GLchar**) &s.source, NULL );
+	glShaderSource( shader, 3, parts, lengths );
 	glCompileShader( shader );
 
 	GLint  compiled;
@@ -88,6 +129,10 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	exit( EXIT_FAILURE );
     }
 
+    if ( programBinariesSupported() && !saveProgramBinary( cachePath, sourceHash, program ) ) {
+	std::cerr << "Could not write program cache " << cachePath << std::endl;
+    }
+
     /* use program object */
     glUseProgram(program);
 
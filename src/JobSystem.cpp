@@ -0,0 +1,174 @@
+#include "JobSystem.h"
+#include <chrono>
+
+// The pool this thread last used and its queue in that pool
+static thread_local const JobSystem* tlsJobSystem = nullptr;
+static thread_local unsigned tlsQueueIndex = 0;
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+    if (workerCount == 0) {
+        unsigned hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    // One deque per worker plus the queues of non-worker threads. The vector
+    // never grows afterwards, so workers can index it without a lock.
+    for (unsigned i = 0; i < workerCount + externalQueueCount; ++i) {
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned JobSystem::currentQueueIndex()
+{
+    if (tlsJobSystem != this) {
+        // First use from a thread that is not one of our workers
+        unsigned external = nextExternalQueue.fetch_add(1, std::memory_order_relaxed);
+        if (external >= externalQueueCount) external = externalQueueCount - 1;
+        tlsJobSystem = this;
+        tlsQueueIndex = (unsigned)workers.size() + external;
+    }
+    return tlsQueueIndex;
+}
+
+void JobSystem::submit(std::function<void()> job, JobCounter* counter)
+{
+    if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    WorkQueue& queue = *queues[currentQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(Job{ std::move(job), counter });
+    }
+    queuedJobs.fetch_add(1, std::memory_order_release);
+
+    // Taking the sleep mutex orders this wakeup after a worker's predicate check
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeCondition.notify_one();
+}
+
+bool JobSystem::popJob(unsigned queueIndex, Job& job)
+{
+    WorkQueue& queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) return false;
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::stealJob(unsigned thiefIndex, Job& job)
+{
+    const unsigned queueCount = (unsigned)queues.size();
+    for (unsigned offset = 1; offset < queueCount; ++offset) {
+        WorkQueue& victim = *queues[(thiefIndex + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.jobs.empty()) continue;
+        job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::popCounterJob(unsigned queueIndex, const JobCounter& counter, Job& job)
+{
+    // A counter's jobs sit in the queue of the thread that submitted them,
+    // which is the waiting thread, unless a worker has already taken them
+    WorkQueue& queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    for (std::deque<Job>::iterator it = queue.jobs.end(); it != queue.jobs.begin();) {
+        --it;
+        if (it->counter != &counter) continue;
+        job = std::move(*it);
+        queue.jobs.erase(it);
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::runJob(Job& job)
+{
+    job.function();
+    if (job.counter) job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::workerLoop(unsigned index)
+{
+    tlsJobSystem = this;
+    tlsQueueIndex = index;
+
+    while (true) {
+        Job job;
+        if (popJob(index, job) || stealJob(index, job)) {
+            runJob(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeCondition.wait(lock, [this] {
+            return stopping.load() || queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping.load() && queuedJobs.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    const unsigned index = currentQueueIndex();
+    unsigned idleRounds = 0;
+    while (!counter.isDone()) {
+        Job job;
+        if (popCounterJob(index, counter, job)) {
+            runJob(job);
+            idleRounds = 0;
+            continue;
+        }
+        // The remaining jobs are running on workers: spin briefly, then sleep
+        // in short steps instead of burning a core the workers could use
+        if (idleRounds < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(idleRounds < 256 ? 10 : 50));
+        }
+        ++idleRounds;
+    }
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grainSize,
+                            const std::function<void(size_t, size_t)>& body)
+{
+    if (end <= begin) return;
+    if (grainSize == 0) grainSize = 1;
+    if (end - begin <= grainSize || workers.empty()) {
+        body(begin, end);
+        return;
+    }
+
+    // The caller runs the first chunk itself and helps with the rest
+    JobCounter counter;
+    for (size_t chunkBegin = begin + grainSize; chunkBegin < end; chunkBegin += grainSize) {
+        size_t chunkEnd = chunkBegin + grainSize < end ? chunkBegin + grainSize : end;
+        submit([&body, chunkBegin, chunkEnd] { body(chunkBegin, chunkEnd); }, &counter);
+    }
+    body(begin, begin + grainSize);
+    wait(counter);
+}
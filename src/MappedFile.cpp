@@ -0,0 +1,111 @@
+#include "MappedFile.h"
+#include <atomic>
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define MAPPED_FILE_USE_MMAP 1
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#elif defined(_WIN32)
+    #include <process.h>
+    #define getpid _getpid
+#endif
+
+MappedFile::MappedFile()
+{
+    view = nullptr;
+    length = 0;
+    opened = false;
+    mapped = false;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+#ifdef MAPPED_FILE_USE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    // Directories and devices have no meaningful size to map or read
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    if (info.st_size > 0) {
+        void* address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            madvise(address, (size_t)info.st_size, MADV_SEQUENTIAL);
+            ::close(fd); // The mapping stays valid after the descriptor is closed
+            view = static_cast<const char*>(address);
+            length = (size_t)info.st_size;
+            opened = true;
+            mapped = true;
+            return true;
+        }
+    }
+    ::close(fd);
+#endif
+
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) return false;
+    long fileSize = std::fseek(file, 0, SEEK_END) == 0 ? std::ftell(file) : -1;
+    if (fileSize < 0 || std::fseek(file, 0, SEEK_SET) != 0) {
+        std::fclose(file);
+        return false;
+    }
+    if (fileSize > 0) {
+        buffer.resize((size_t)fileSize);
+        buffer.resize(std::fread(buffer.data(), 1, buffer.size(), file));
+    }
+    std::fclose(file);
+
+    view = buffer.data();
+    length = buffer.size();
+    opened = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef MAPPED_FILE_USE_MMAP
+    if (mapped) munmap(const_cast<char*>(view), length);
+#endif
+    std::vector<char>().swap(buffer);
+    view = nullptr;
+    length = 0;
+    opened = false;
+    mapped = false;
+}
+
+bool writeFileAtomically(const std::string& path, const std::vector<FileChunk>& chunks)
+{
+    static std::atomic<unsigned> writeSerial{0};
+    const std::string tempPath = path + "." + std::to_string((long)getpid()) + "." +
+                                 std::to_string(writeSerial.fetch_add(1)) + ".tmp";
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < chunks.size(); ++i) {
+        ok = chunks[i].size == 0 || std::fwrite(chunks[i].data, 1, chunks[i].size, file) == chunks[i].size;
+    }
+    ok = std::fclose(file) == 0 && ok;
+
+    if (ok) {
+#ifdef _WIN32
+        std::remove(path.c_str()); // rename does not replace existing files on Windows
+#endif
+        ok = std::rename(tempPath.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) std::remove(tempPath.c_str());
+    return ok;
+}
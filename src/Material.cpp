@@ -13,9 +13,10 @@ Material::Material(GLfloat sIntensity, GLfloat shine){
     
 }
 
-void Material::UseMaterial(GLuint specularIntensityLoc, GLuint shininessLoc){
-    glUniform1f(specularIntensityLoc, specularIntensity);
-    glUniform1f(shininessLoc,shininess);
+void Material::WriteBlock(MaterialBlockEntry& entry) const{
+    entry.specularIntensity = specularIntensity;
+    entry.shininess = shininess;
+    entry.padding[0] = entry.padding[1] = 0.0f;
     
 }
 
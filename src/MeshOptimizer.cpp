@@ -0,0 +1,166 @@
+#include "MeshOptimizer.h"
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// Forsyth's constants. The simulated cache is LRU and larger than real
+// FIFO caches, which still favours an order that reuses recent vertices.
+const int optimizerCacheSize = 32;
+const float cacheDecayPower = 1.5f;
+const float lastTriangleScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+
+float vertexScore(int cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) return -1.0f; // No triangle needs it any more
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // Used by the last triangle: a fixed score, so the next triangle
+            // does not simply repeat the same edge
+            score = lastTriangleScore;
+        } else {
+            score = std::pow(1.0f - (float)(cachePosition - 3) / (optimizerCacheSize - 3), cacheDecayPower);
+        }
+    }
+    // Finishing vertices with few triangles left avoids leaving lone triangles behind
+    return score + valenceBoostScale * std::pow((float)remainingTriangles, -valenceBoostPower);
+}
+
+template <typename Index>
+VertexCacheStats simulateFifoCache(const Index* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize) {
+    // FIFO: a hit does not refresh the entry. A vertex is in the cache while
+    // fewer than cacheSize misses have happened since its own.
+    std::vector<size_t> missTime(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        GLuint vertex = indices[i];
+        if (missTime[vertex] == 0 || misses + 1 - missTime[vertex] > cacheSize) missTime[vertex] = ++misses;
+    }
+
+    VertexCacheStats stats;
+    stats.acmr = indexCount >= 3 ? (float)misses / (float)(indexCount / 3) : 0.0f;
+    stats.atvr = vertexCount > 0 ? (float)misses / (float)vertexCount : 0.0f;
+    return stats;
+}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const GLuint* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize)
+{
+    return simulateFifoCache(indices, indexCount, vertexCount, cacheSize);
+}
+
+VertexCacheStats analyzeVertexCache(const GLushort* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize)
+{
+    return simulateFifoCache(indices, indexCount, vertexCount, cacheSize);
+}
+
+void optimizeVertexCache(GLuint* indices, size_t indexCount, size_t vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+
+    // Triangles of each vertex, packed in one array. The first remaining[v]
+    // entries of a vertex's range are the triangles not yet emitted.
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i) ++remaining[indices[i]];
+    std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<uint32_t> triangles(indexCount);
+    {
+        std::vector<size_t> next(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i) triangles[next[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScores[v] = vertexScore(-1, remaining[v]);
+    std::vector<float> triangleScores(triangleCount);
+    size_t best = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const GLuint* corner = &indices[t * 3];
+        triangleScores[t] = vertexScores[corner[0]] + vertexScores[corner[1]] + vertexScores[corner[2]];
+        if (triangleScores[t] > triangleScores[best]) best = t;
+    }
+
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<GLuint> output;
+    output.reserve(indexCount);
+    GLuint cache[optimizerCacheSize + 3];
+    GLuint newCache[optimizerCacheSize + 3];
+    int cacheCount = 0;
+    size_t nextUnemitted = 0; // Scan position for when no cached vertex has triangles left
+
+    while (output.size() < indexCount) {
+        const GLuint* corner = &indices[best * 3];
+        emitted[best] = 1;
+        output.insert(output.end(), corner, corner + 3);
+
+        // The emitted triangle's vertices go to the front of the cache; the
+        // rest keep their order behind them
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            GLuint vertex = corner[k];
+            newCache[newCount++] = vertex;
+            uint32_t* list = &triangles[firstTriangle[vertex]];
+            uint32_t* last = list + remaining[vertex] - 1;
+            std::swap(*std::find(list, last, (uint32_t)best), *last);
+            --remaining[vertex];
+        }
+        for (int i = 0; i < cacheCount; ++i) {
+            GLuint vertex = cache[i];
+            if (vertex != corner[0] && vertex != corner[1] && vertex != corner[2]) newCache[newCount++] = vertex;
+        }
+
+        // Rescore every vertex whose position changed, including the ones
+        // just pushed out, then the triangles still using them
+        for (int i = 0; i < newCount; ++i) {
+            GLuint vertex = newCache[i];
+            cachePosition[vertex] = i < optimizerCacheSize ? i : -1;
+            vertexScores[vertex] = vertexScore(cachePosition[vertex], remaining[vertex]);
+        }
+        float bestScore = -1.0f;
+        bool found = false;
+        for (int i = 0; i < newCount; ++i) {
+            GLuint vertex = newCache[i];
+            const uint32_t* list = &triangles[firstTriangle[vertex]];
+            for (uint32_t j = 0; j < remaining[vertex]; ++j) {
+                uint32_t t = list[j];
+                const GLuint* c = &indices[t * 3];
+                triangleScores[t] = vertexScores[c[0]] + vertexScores[c[1]] + vertexScores[c[2]];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                    found = true;
+                }
+            }
+        }
+        cacheCount = newCount < optimizerCacheSize ? newCount : optimizerCacheSize;
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        if (!found) {
+            // Nothing cached has work left: start again from any remaining triangle
+            while (nextUnemitted < triangleCount && emitted[nextUnemitted]) ++nextUnemitted;
+            best = nextUnemitted;
+        }
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<GLuint> optimizeVertexFetch(GLuint* indices, size_t indexCount, size_t vertexCount)
+{
+    const GLuint unused = ~0u;
+    std::vector<GLuint> remap(vertexCount, unused);
+    GLuint next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        GLuint& target = remap[indices[i]];
+        if (target == unused) target = next++;
+        indices[i] = target;
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] == unused) remap[v] = next++;
+    }
+    return remap;
+}
@@ -0,0 +1,332 @@
+#include "Mipmap.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+#include <cmath>
+
+#if defined(SPHERE_HAS_SSE)
+    #include <immintrin.h>
+#endif
+
+// Levels are kept as linear-light RGBA floats (alpha unused) so one texel is
+// exactly one SSE register. A 2x downsample is done as two separable passes:
+// horizontally from the source level into a half-width temporary, then
+// vertically into the destination. Taps outside the image clamp to the edge.
+namespace {
+
+// Rows of a pass handled by one job
+const size_t rowGrainSize = 16;
+
+struct LinearImage {
+    int width = 0;
+    int height = 0;
+    std::vector<float> texels; // RGBA per texel
+};
+
+struct MipKernel {
+    int taps;
+    int offset; // Output texel x reads source texels 2x + offset ... 2x + offset + taps - 1
+    float weights[6];
+};
+
+double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+MipKernel makeKernel(MipFilter filter) {
+    MipKernel kernel;
+    if (filter == MipFilter::Box) {
+        kernel.taps = 2;
+        kernel.offset = 0;
+        kernel.weights[0] = kernel.weights[1] = 0.5f;
+        return kernel;
+    }
+
+    // Sinc with the cutoff at half the source rate, windowed by a Kaiser
+    // window (alpha 4) spanning three source texels on each side
+    const double pi = 3.14159265358979323846;
+    const double alpha = 4.0, halfWidth = 3.0;
+    double weights[6], sum = 0.0;
+    for (int k = 0; k < 6; ++k) {
+        double d = k - 2.5; // Distance from the centre of the 2x2 footprint
+        double x = d * 0.5;
+        double sinc = std::sin(pi * x) / (pi * x);
+        double r = d / halfWidth;
+        double window = besselI0(alpha * std::sqrt(1.0 - r * r)) / besselI0(alpha);
+        weights[k] = sinc * window;
+        sum += weights[k];
+    }
+    kernel.taps = 6;
+    kernel.offset = -2;
+    for (int k = 0; k < 6; ++k) kernel.weights[k] = (float)(weights[k] / sum);
+    return kernel;
+}
+
+inline int clampIndex(int i, int size) {
+    return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+// --- sRGB conversion -------------------------------------------------------
+
+double srgbToLinear(double c) {
+    return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+struct SRGBTables {
+    float toLinear[256];
+    float thresholds[255];      // Linear value halfway between consecutive sRGB codes
+    unsigned char start[1025];  // Lowest code for linear values >= i / 1024
+
+    SRGBTables() {
+        for (int i = 0; i < 256; ++i) toLinear[i] = (float)srgbToLinear(i / 255.0);
+        for (int i = 0; i < 255; ++i) thresholds[i] = (float)srgbToLinear((i + 0.5) / 255.0);
+        int code = 0;
+        for (int i = 0; i <= 1024; ++i) {
+            while (code < 255 && thresholds[code] < i / 1024.0f) ++code;
+            start[i] = (unsigned char)code;
+        }
+    }
+};
+
+const SRGBTables& srgbTables() {
+    static const SRGBTables tables;
+    return tables;
+}
+
+// Rounds in sRGB space: the coarse table gives a lower bound and only a few
+// thresholds are compared after it
+inline unsigned char linearToSRGB8(const SRGBTables& tables, float v) {
+    if (!(v > 0.0f)) return 0;
+    if (v >= 1.0f) return 255;
+    int code = tables.start[(int)(v * 1024.0f)];
+    while (code < 255 && v > tables.thresholds[code]) ++code;
+    return (unsigned char)code;
+}
+
+// --- Horizontal pass: src (w x h) -> dst (w/2 x h) ---------------------------
+
+void horizontalRowsScalar(const LinearImage& src, LinearImage& dst, const MipKernel& kernel, int rowBegin, int rowEnd) {
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        const float* in = &src.texels[(size_t)y * src.width * 4];
+        float* out = &dst.texels[(size_t)y * dst.width * 4];
+        for (int x = 0; x < dst.width; ++x) {
+            float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int k = 0; k < kernel.taps; ++k) {
+                const float* t = in + clampIndex(2 * x + kernel.offset + k, src.width) * 4;
+                for (int c = 0; c < 4; ++c) acc[c] += kernel.weights[k] * t[c];
+            }
+            for (int c = 0; c < 4; ++c) out[x * 4 + c] = acc[c];
+        }
+    }
+}
+
+// --- Vertical pass: src (w x h) -> dst (w x h/2) -----------------------------
+
+void verticalRowsScalar(const LinearImage& src, LinearImage& dst, const MipKernel& kernel, int rowBegin, int rowEnd) {
+    const size_t rowFloats = (size_t)dst.width * 4;
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        float* out = &dst.texels[y * rowFloats];
+        for (size_t i = 0; i < rowFloats; ++i) out[i] = 0.0f;
+        for (int k = 0; k < kernel.taps; ++k) {
+            const float* in = &src.texels[clampIndex(2 * y + kernel.offset + k, src.height) * rowFloats];
+            const float w = kernel.weights[k];
+            for (size_t i = 0; i < rowFloats; ++i) out[i] += w * in[i];
+        }
+    }
+}
+
+#if defined(SPHERE_HAS_SSE)
+
+// One texel per register
+void horizontalRowsSSE(const LinearImage& src, LinearImage& dst, const MipKernel& kernel, int rowBegin, int rowEnd) {
+    __m128 weights[6];
+    for (int k = 0; k < kernel.taps; ++k) weights[k] = _mm_set1_ps(kernel.weights[k]);
+
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        const float* in = &src.texels[(size_t)y * src.width * 4];
+        float* out = &dst.texels[(size_t)y * dst.width * 4];
+        for (int x = 0; x < dst.width; ++x) {
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < kernel.taps; ++k) {
+                __m128 t = _mm_loadu_ps(in + clampIndex(2 * x + kernel.offset + k, src.width) * 4);
+                acc = _mm_add_ps(acc, _mm_mul_ps(weights[k], t));
+            }
+            _mm_storeu_ps(out + x * 4, acc);
+        }
+    }
+}
+
+// One texel per register, i.e. four floats of the row at a time
+void verticalRowsSSE(const LinearImage& src, LinearImage& dst, const MipKernel& kernel, int rowBegin, int rowEnd) {
+    const size_t rowFloats = (size_t)dst.width * 4;
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        const float* in[6];
+        __m128 weights[6];
+        for (int k = 0; k < kernel.taps; ++k) {
+            in[k] = &src.texels[clampIndex(2 * y + kernel.offset + k, src.height) * rowFloats];
+            weights[k] = _mm_set1_ps(kernel.weights[k]);
+        }
+        float* out = &dst.texels[y * rowFloats];
+        for (size_t i = 0; i < rowFloats; i += 4) {
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < kernel.taps; ++k) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(weights[k], _mm_loadu_ps(in[k] + i)));
+            }
+            _mm_storeu_ps(out + i, acc);
+        }
+    }
+}
+
+#endif // SPHERE_HAS_SSE
+
+#if defined(SPHERE_HAS_AVX2)
+
+// Two output texels per register: the low half accumulates texel x, the
+// high half texel x + 1, whose taps start two source texels further on
+SPHERE_TARGET_AVX2
+void horizontalRowsAVX2(const LinearImage& src, LinearImage& dst, const MipKernel& kernel, int rowBegin, int rowEnd) {
+    __m256 weights[6];
+    for (int k = 0; k < kernel.taps; ++k) weights[k] = _mm256_set1_ps(kernel.weights[k]);
+
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        const float* in = &src.texels[(size_t)y * src.width * 4];
+        float* out = &dst.texels[(size_t)y * dst.width * 4];
+        int x = 0;
+        for (; x + 2 <= dst.width; x += 2) {
+            __m256 acc = _mm256_setzero_ps();
+            for (int k = 0; k < kernel.taps; ++k) {
+                __m128 lo = _mm_loadu_ps(in + clampIndex(2 * x + kernel.offset + k, src.width) * 4);
+                __m128 hi = _mm_loadu_ps(in + clampIndex(2 * x + 2 + kernel.offset + k, src.width) * 4);
+                __m256 t = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(weights[k], t));
+            }
+            _mm256_storeu_ps(out + x * 4, acc);
+        }
+        for (; x < dst.width; ++x) {
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < kernel.taps; ++k) {
+                __m128 t = _mm_loadu_ps(in + clampIndex(2 * x + kernel.offset + k, src.width) * 4);
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm256_castps256_ps128(weights[k]), t));
+            }
+            _mm_storeu_ps(out + x * 4, acc);
+        }
+    }
+}
+
+// Two texels (eight floats) of the row at a time
+SPHERE_TARGET_AVX2
+void verticalRowsAVX2(const LinearImage& src, LinearImage& dst, const MipKernel& kernel, int rowBegin, int rowEnd) {
+    const size_t rowFloats = (size_t)dst.width * 4;
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        const float* in[6];
+        __m256 weights[6];
+        for (int k = 0; k < kernel.taps; ++k) {
+            in[k] = &src.texels[clampIndex(2 * y + kernel.offset + k, src.height) * rowFloats];
+            weights[k] = _mm256_set1_ps(kernel.weights[k]);
+        }
+        float* out = &dst.texels[y * rowFloats];
+        size_t i = 0;
+        for (; i + 8 <= rowFloats; i += 8) {
+            __m256 acc = _mm256_setzero_ps();
+            for (int k = 0; k < kernel.taps; ++k) {
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(weights[k], _mm256_loadu_ps(in[k] + i)));
+            }
+            _mm256_storeu_ps(out + i, acc);
+        }
+        for (; i < rowFloats; i += 4) {
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < kernel.taps; ++k) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm256_castps256_ps128(weights[k]), _mm_loadu_ps(in[k] + i)));
+            }
+            _mm_storeu_ps(out + i, acc);
+        }
+    }
+}
+
+#endif // SPHERE_HAS_AVX2
+
+typedef void (*PassFunction)(const LinearImage&, LinearImage&, const MipKernel&, int, int);
+
+void selectPasses(PassFunction& horizontal, PassFunction& vertical) {
+#if defined(SPHERE_HAS_AVX2)
+    if (cpuHasAVX2()) { horizontal = horizontalRowsAVX2; vertical = verticalRowsAVX2; return; }
+#endif
+#if defined(SPHERE_HAS_SSE)
+    if (cpuHasSSE2()) { horizontal = horizontalRowsSSE; vertical = verticalRowsSSE; return; }
+#endif
+    horizontal = horizontalRowsScalar;
+    vertical = verticalRowsScalar;
+}
+
+// Runs body over [0, rows) on the job system when one is given
+template <typename Body>
+void forEachRowRange(JobSystem* jobs, int rows, const Body& body) {
+    if (jobs == nullptr) {
+        body(0, rows);
+        return;
+    }
+    jobs->parallelFor(0, (size_t)rows, rowGrainSize, [&body](size_t begin, size_t end) {
+        body((int)begin, (int)end);
+    });
+}
+
+} // namespace
+
+void buildMipChain(const PPMImage& base, std::vector<PPMImage>& levels, MipFilter filter, JobSystem* jobs)
+{
+    levels.clear();
+    if (!base.isValid || base.width <= 0 || base.height <= 0) return;
+
+    const SRGBTables& tables = srgbTables();
+    const MipKernel kernel = makeKernel(filter);
+    PassFunction horizontal, vertical;
+    selectPasses(horizontal, vertical);
+
+    // Decode the base level to linear light
+    LinearImage current;
+    current.width = base.width;
+    current.height = base.height;
+    current.texels.resize((size_t)base.width * base.height * 4);
+    forEachRowRange(jobs, base.height, [&](int rowBegin, int rowEnd) {
+        for (size_t i = (size_t)rowBegin * base.width; i < (size_t)rowEnd * base.width; ++i) {
+            for (int c = 0; c < 3; ++c) current.texels[i * 4 + c] = tables.toLinear[base.data[i * 3 + c]];
+            current.texels[i * 4 + 3] = 0.0f;
+        }
+    });
+
+    LinearImage halfWidth, next;
+    while (current.width > 1 || current.height > 1) {
+        const int width = current.width > 1 ? current.width / 2 : 1;
+        const int height = current.height > 1 ? current.height / 2 : 1;
+
+        halfWidth.width = width;
+        halfWidth.height = current.height;
+        halfWidth.texels.resize((size_t)width * current.height * 4);
+        forEachRowRange(jobs, current.height, [&](int rowBegin, int rowEnd) {
+            horizontal(current, halfWidth, kernel, rowBegin, rowEnd);
+        });
+
+        next.width = width;
+        next.height = height;
+        next.texels.resize((size_t)width * height * 4);
+        levels.push_back(PPMImage());
+        PPMImage& level = levels.back();
+        level.width = width;
+        level.height = height;
+        level.data.resize((size_t)width * height * 3);
+        level.isValid = true;
+        forEachRowRange(jobs, height, [&](int rowBegin, int rowEnd) {
+            vertical(halfWidth, next, kernel, rowBegin, rowEnd);
+            for (size_t i = (size_t)rowBegin * width; i < (size_t)rowEnd * width; ++i) {
+                for (int c = 0; c < 3; ++c) level.data[i * 3 + c] = linearToSRGB8(tables, next.texels[i * 4 + c]);
+            }
+        });
+
+        std::swap(current, next);
+    }
+}
@@ -53,9 +53,9 @@ void PhysicsObject::applyResistence(vec3 resistenceCoefficient)
     float velocityThresholdX = 0.03f; // Adjust as needed for x-velocity
  
     // Apply threshold for x-velocity
-    if (abs(velocity.x) > velocityThresholdX)
+    if (std::fabs(velocity.x) > velocityThresholdX)
     {
-        vec3 resistance_force_x = -vec3(resistenceCoefficient.x * abs(velocity.x) * velocity.x, 0.0f, 0.0f);
+        vec3 resistance_force_x = -vec3(resistenceCoefficient.x * std::fabs(velocity.x) * velocity.x, 0.0f, 0.0f);
         applyForce(resistance_force_x);
     }
     else {
@@ -64,7 +64,7 @@ void PhysicsObject::applyResistence(vec3 resistenceCoefficient)
 
     // Apply quadratic resistance for y and z velocities
     vec3 resistance_force_yz = -vec3(0.0f,
-        resistenceCoefficient.y * abs(velocity.y) * velocity.y,
-        resistenceCoefficient.z * abs(velocity.z) * velocity.z);
+        resistenceCoefficient.y * std::fabs(velocity.y) * velocity.y,
+        resistenceCoefficient.z * std::fabs(velocity.z) * velocity.z);
     applyForce(resistance_force_yz);
 }
@@ -0,0 +1,219 @@
+#include "PhysicsWorld.h"
+#include "PhysicsObject.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+PhysicsWorld::PhysicsWorld()
+{
+    gravity = vec3(0.0, -2.5, 0.0);
+    resistence = vec3(1.0f, 0.1f, 0.1f);
+    restitution = 0.9f;
+    floorY = bottomY;
+    velocityThresholdX = 0.03f;
+    collisionsEnabled = true;
+    maxRadius = 0.0f;
+    parallelGrainSize = 16384;
+    kernel = bestKernel();
+}
+
+size_t PhysicsWorld::addBody(vec3 initPos, vec3 initVel, float initMass, float initRadius)
+{
+    x.push_back(initPos.x);
+    y.push_back(initPos.y);
+    z.push_back(initPos.z);
+    prevX.push_back(initPos.x);
+    prevY.push_back(initPos.y);
+    prevZ.push_back(initPos.z);
+    vx.push_back(initVel.x);
+    vy.push_back(initVel.y);
+    vz.push_back(initVel.z);
+    ax.push_back(0.0f);
+    ay.push_back(0.0f);
+    az.push_back(0.0f);
+    mass.push_back(initMass);
+    invMass.push_back(1.0f / initMass);
+    radius.push_back(initRadius);
+    if (initRadius > maxRadius) maxRadius = initRadius;
+    return x.size() - 1;
+}
+
+void PhysicsWorld::reserve(size_t count)
+{
+    for (std::vector<float>* a : { &x, &y, &z, &prevX, &prevY, &prevZ, &vx, &vy, &vz, &ax, &ay, &az, &mass, &invMass, &radius })
+        a->reserve(count);
+}
+
+void PhysicsWorld::clear()
+{
+    for (std::vector<float>* a : { &x, &y, &z, &prevX, &prevY, &prevZ, &vx, &vy, &vz, &ax, &ay, &az, &mass, &invMass, &radius })
+        a->clear();
+    maxRadius = 0.0f;
+}
+
+void PhysicsWorld::applyForce(size_t i, vec3 force)
+{
+    ax[i] += force.x * invMass[i];
+    ay[i] += force.y * invMass[i];
+    az[i] += force.z * invMass[i];
+}
+
+void PhysicsWorld::update(double deltaTime, JobSystem* jobs)
+{
+    const float dt = (float)deltaTime;
+    prevX = x;
+    prevY = y;
+    prevZ = z;
+
+    if (jobs == nullptr || size() <= parallelGrainSize) {
+        updateRange(0, size(), dt);
+    } else {
+        // Bodies are independent, so every chunk can be integrated on its own
+        size_t grain = (parallelGrainSize + 7) & ~size_t(7);
+        jobs->parallelFor(0, size(), grain, [this, dt](size_t begin, size_t end) {
+            updateRange(begin, end, dt);
+        });
+    }
+
+    if (collisionsEnabled) solveCollisions(jobs);
+}
+
+void PhysicsWorld::solveCollisions(JobSystem* jobs)
+{
+    contacts.clear();
+    if (size() < 2 || maxRadius <= 0.0f) return;
+
+    // A cell as wide as the largest sphere means overlapping spheres are
+    // always in the same or neighbouring cells
+    grid.update(x.data(), y.data(), z.data(), size(), 2.0f * maxRadius);
+    grid.findPairs(x.data(), y.data(), z.data(), radius.data(), contacts, jobs);
+
+    // Pairs share bodies, so the impulses are applied one after another
+    for (const ContactPair& pair : contacts) {
+        resolveContact(pair.a, pair.b);
+    }
+}
+
+// Same restitution model as PhysicsObject::bounce, v -= (1 + e) * dot(v, n) * n,
+// applied to the relative velocity and split between the bodies by inverse mass.
+// With one body of infinite mass this reduces to the floor bounce exactly.
+void PhysicsWorld::resolveContact(uint32_t a, uint32_t b)
+{
+    float dx = x[b] - x[a];
+    float dy = y[b] - y[a];
+    float dz = z[b] - z[a];
+    float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    float penetration = radius[a] + radius[b] - distance;
+    if (penetration <= 0.0f) return; // Separated by an earlier contact this step
+
+    // Normal from a to b; coincident centres are pushed apart vertically
+    vec3 n = distance > 1e-6f ? vec3(dx / distance, dy / distance, dz / distance) : vec3(0.0f, 1.0f, 0.0f);
+    float invMassSum = invMass[a] + invMass[b];
+    if (invMassSum <= 0.0f) return;
+
+    // Move the spheres out of each other (not to sink), heavier ones move less
+    float correctionA = penetration * invMass[a] / invMassSum;
+    float correctionB = penetration * invMass[b] / invMassSum;
+    x[a] -= n.x * correctionA; y[a] -= n.y * correctionA; z[a] -= n.z * correctionA;
+    x[b] += n.x * correctionB; y[b] += n.y * correctionB; z[b] += n.z * correctionB;
+
+    // Only approaching bodies bounce
+    float approach = (vx[b] - vx[a]) * n.x + (vy[b] - vy[a]) * n.y + (vz[b] - vz[a]) * n.z;
+    if (approach >= 0.0f) return;
+
+    float impulse = (1.0f + restitution) * approach / invMassSum;
+    vx[a] += impulse * invMass[a] * n.x; vy[a] += impulse * invMass[a] * n.y; vz[a] += impulse * invMass[a] * n.z;
+    vx[b] -= impulse * invMass[b] * n.x; vy[b] -= impulse * invMass[b] * n.y; vz[b] -= impulse * invMass[b] * n.z;
+}
+
+void PhysicsWorld::updateRange(size_t begin, size_t end, float deltaTime)
+{
+    switch (kernel) {
+    case PhysicsKernel::AVX2: updateRangeAVX2(begin, end, deltaTime); break;
+    case PhysicsKernel::SSE: updateRangeSSE(begin, end, deltaTime); break;
+    default: updateRangeScalar(begin, end, deltaTime); break;
+    }
+}
+
+PhysicsKernel PhysicsWorld::bestKernel()
+{
+    if (cpuHasAVX2()) return PhysicsKernel::AVX2;
+    if (cpuHasSSE2()) return PhysicsKernel::SSE;
+    return PhysicsKernel::Scalar;
+}
+
+void PhysicsWorld::setKernel(PhysicsKernel requested)
+{
+    if (requested == PhysicsKernel::AVX2 && !cpuHasAVX2()) requested = PhysicsKernel::SSE;
+    if (requested == PhysicsKernel::SSE && !cpuHasSSE2()) requested = PhysicsKernel::Scalar;
+    kernel = requested;
+}
+
+const char* PhysicsWorld::kernelName(PhysicsKernel k)
+{
+    switch (k) {
+    case PhysicsKernel::AVX2: return "AVX2";
+    case PhysicsKernel::SSE: return "SSE";
+    default: return "Scalar";
+    }
+}
+
+// The operation order below mirrors PhysicsObject::update/bounce/applyResistence
+// term by term, so a body in the world follows the same trajectory as a
+// PhysicsObject with the same initial state. The SIMD kernels in
+// PhysicsWorldSIMD.cpp follow the same order lane by lane.
+void PhysicsWorld::updateRangeScalar(size_t begin, size_t end, float dt)
+{
+    float* __restrict px = x.data();
+    float* __restrict py = y.data();
+    float* __restrict pz = z.data();
+    float* __restrict pvx = vx.data();
+    float* __restrict pvy = vy.data();
+    float* __restrict pvz = vz.data();
+    float* __restrict pax = ax.data();
+    float* __restrict pay = ay.data();
+    float* __restrict paz = az.data();
+    const float* __restrict pm = mass.data();
+    const float* __restrict pim = invMass.data();
+
+    const float bounceFactor = 1.0f + restitution;
+    const float floor = floorY;
+    const float thresholdX = velocityThresholdX;
+    const float gx = gravity.x, gy = gravity.y, gz = gravity.z;
+    const float rx = resistence.x, ry = resistence.y, rz = resistence.z;
+
+    for (size_t i = begin; i < end; ++i) {
+        float posY = py[i];
+        float velX = pvx[i], velY = pvy[i], velZ = pvz[i];
+
+        // Floor bounce
+        if (posY <= floor && velY < 0.0f) {
+            velY = velY - bounceFactor * velY;
+            posY = floor; // not to sink
+        }
+
+        // Gravity
+        float accX = pax[i] + (gx * pm[i]) * pim[i];
+        float accY = pay[i] + (gy * pm[i]) * pim[i];
+        float accZ = paz[i] + (gz * pm[i]) * pim[i];
+
+        // Quadratic resistance, x-velocity snaps to zero below the threshold
+        if (std::fabs(velX) > thresholdX) {
+            accX += -(rx * std::fabs(velX) * velX) * pim[i];
+        } else {
+            velX = 0.0f;
+        }
+        accY += -(ry * std::fabs(velY) * velY) * pim[i];
+        accZ += -(rz * std::fabs(velZ) * velZ) * pim[i];
+
+        // Integrate
+        px[i] = (px[i] + dt * (dt * (0.5f * accX))) + dt * velX;
+        py[i] = (posY + dt * (dt * (0.5f * accY))) + dt * velY;
+        pz[i] = (pz[i] + dt * (dt * (0.5f * accZ))) + dt * velZ;
+        pvx[i] = velX + dt * accX;
+        pvy[i] = velY + dt * accY;
+        pvz[i] = velZ + dt * accZ;
+        pax[i] = 0.0f;
+        pay[i] = 0.0f;
+        paz[i] = 0.0f;
+    }
+}
@@ -0,0 +1,185 @@
+#include "PhysicsWorld.h"
+#include "CpuFeatures.h"
+
+#if defined(SPHERE_HAS_SSE)
+    #include <immintrin.h>
+#endif
+
+// Vectorized versions of PhysicsWorld::updateRangeScalar. Each lane performs
+// exactly the same IEEE operations in the same order as the scalar kernel;
+// the two data-dependent branches become masks:
+//   - floor bounce:  (y <= floorY) & (vy < 0) selects the reflected vy and floorY
+//   - x threshold:   |vx| > velocityThresholdX selects the drag term, else vx = 0
+// Bodies left over after the last full vector go through the scalar kernel.
+
+#if defined(SPHERE_HAS_SSE)
+
+void PhysicsWorld::updateRangeSSE(size_t begin, size_t end, float dt)
+{
+    float* px = x.data();
+    float* py = y.data();
+    float* pz = z.data();
+    float* pvx = vx.data();
+    float* pvy = vy.data();
+    float* pvz = vz.data();
+    float* pax = ax.data();
+    float* pay = ay.data();
+    float* paz = az.data();
+    const float* pm = mass.data();
+    const float* pim = invMass.data();
+
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 bounceFactor = _mm_set1_ps(1.0f + restitution);
+    const __m128 floor = _mm_set1_ps(floorY);
+    const __m128 thresholdX = _mm_set1_ps(velocityThresholdX);
+    const __m128 gx = _mm_set1_ps(gravity.x), gy = _mm_set1_ps(gravity.y), gz = _mm_set1_ps(gravity.z);
+    const __m128 rx = _mm_set1_ps(resistence.x), ry = _mm_set1_ps(resistence.y), rz = _mm_set1_ps(resistence.z);
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 posY = _mm_loadu_ps(py + i);
+        __m128 velX = _mm_loadu_ps(pvx + i);
+        __m128 velY = _mm_loadu_ps(pvy + i);
+        __m128 velZ = _mm_loadu_ps(pvz + i);
+        __m128 m = _mm_loadu_ps(pm + i);
+        __m128 im = _mm_loadu_ps(pim + i);
+
+        // Floor bounce
+        __m128 hit = _mm_and_ps(_mm_cmple_ps(posY, floor), _mm_cmplt_ps(velY, zero));
+        __m128 bouncedVelY = _mm_sub_ps(velY, _mm_mul_ps(bounceFactor, velY));
+        velY = _mm_or_ps(_mm_and_ps(hit, bouncedVelY), _mm_andnot_ps(hit, velY));
+        posY = _mm_or_ps(_mm_and_ps(hit, floor), _mm_andnot_ps(hit, posY));
+
+        // Gravity
+        __m128 accX = _mm_add_ps(_mm_loadu_ps(pax + i), _mm_mul_ps(_mm_mul_ps(gx, m), im));
+        __m128 accY = _mm_add_ps(_mm_loadu_ps(pay + i), _mm_mul_ps(_mm_mul_ps(gy, m), im));
+        __m128 accZ = _mm_add_ps(_mm_loadu_ps(paz + i), _mm_mul_ps(_mm_mul_ps(gz, m), im));
+
+        // Quadratic resistance, x-velocity snaps to zero below the threshold
+        __m128 absX = _mm_andnot_ps(signMask, velX);
+        __m128 keepX = _mm_cmpgt_ps(absX, thresholdX);
+        __m128 dragX = _mm_xor_ps(signMask, _mm_mul_ps(_mm_mul_ps(rx, absX), velX));
+        __m128 dragAccX = _mm_add_ps(accX, _mm_mul_ps(dragX, im));
+        accX = _mm_or_ps(_mm_and_ps(keepX, dragAccX), _mm_andnot_ps(keepX, accX));
+        velX = _mm_and_ps(keepX, velX);
+
+        __m128 dragY = _mm_xor_ps(signMask, _mm_mul_ps(_mm_mul_ps(ry, _mm_andnot_ps(signMask, velY)), velY));
+        __m128 dragZ = _mm_xor_ps(signMask, _mm_mul_ps(_mm_mul_ps(rz, _mm_andnot_ps(signMask, velZ)), velZ));
+        accY = _mm_add_ps(accY, _mm_mul_ps(dragY, im));
+        accZ = _mm_add_ps(accZ, _mm_mul_ps(dragZ, im));
+
+        // Integrate
+        __m128 stepX = _mm_mul_ps(vdt, _mm_mul_ps(vdt, _mm_mul_ps(half, accX)));
+        __m128 stepY = _mm_mul_ps(vdt, _mm_mul_ps(vdt, _mm_mul_ps(half, accY)));
+        __m128 stepZ = _mm_mul_ps(vdt, _mm_mul_ps(vdt, _mm_mul_ps(half, accZ)));
+        _mm_storeu_ps(px + i, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(px + i), stepX), _mm_mul_ps(vdt, velX)));
+        _mm_storeu_ps(py + i, _mm_add_ps(_mm_add_ps(posY, stepY), _mm_mul_ps(vdt, velY)));
+        _mm_storeu_ps(pz + i, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(pz + i), stepZ), _mm_mul_ps(vdt, velZ)));
+        _mm_storeu_ps(pvx + i, _mm_add_ps(velX, _mm_mul_ps(vdt, accX)));
+        _mm_storeu_ps(pvy + i, _mm_add_ps(velY, _mm_mul_ps(vdt, accY)));
+        _mm_storeu_ps(pvz + i, _mm_add_ps(velZ, _mm_mul_ps(vdt, accZ)));
+        _mm_storeu_ps(pax + i, zero);
+        _mm_storeu_ps(pay + i, zero);
+        _mm_storeu_ps(paz + i, zero);
+    }
+
+    updateRangeScalar(i, end, dt);
+}
+
+#else
+
+void PhysicsWorld::updateRangeSSE(size_t begin, size_t end, float dt)
+{
+    updateRangeScalar(begin, end, dt);
+}
+
+#endif // SPHERE_HAS_SSE
+
+#if defined(SPHERE_HAS_AVX2)
+
+SPHERE_TARGET_AVX2
+void PhysicsWorld::updateRangeAVX2(size_t begin, size_t end, float dt)
+{
+    float* px = x.data();
+    float* py = y.data();
+    float* pz = z.data();
+    float* pvx = vx.data();
+    float* pvy = vy.data();
+    float* pvz = vz.data();
+    float* pax = ax.data();
+    float* pay = ay.data();
+    float* paz = az.data();
+    const float* pm = mass.data();
+    const float* pim = invMass.data();
+
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 bounceFactor = _mm256_set1_ps(1.0f + restitution);
+    const __m256 floor = _mm256_set1_ps(floorY);
+    const __m256 thresholdX = _mm256_set1_ps(velocityThresholdX);
+    const __m256 gx = _mm256_set1_ps(gravity.x), gy = _mm256_set1_ps(gravity.y), gz = _mm256_set1_ps(gravity.z);
+    const __m256 rx = _mm256_set1_ps(resistence.x), ry = _mm256_set1_ps(resistence.y), rz = _mm256_set1_ps(resistence.z);
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 posY = _mm256_loadu_ps(py + i);
+        __m256 velX = _mm256_loadu_ps(pvx + i);
+        __m256 velY = _mm256_loadu_ps(pvy + i);
+        __m256 velZ = _mm256_loadu_ps(pvz + i);
+        __m256 m = _mm256_loadu_ps(pm + i);
+        __m256 im = _mm256_loadu_ps(pim + i);
+
+        // Floor bounce
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(posY, floor, _CMP_LE_OQ), _mm256_cmp_ps(velY, zero, _CMP_LT_OQ));
+        __m256 bouncedVelY = _mm256_sub_ps(velY, _mm256_mul_ps(bounceFactor, velY));
+        velY = _mm256_blendv_ps(velY, bouncedVelY, hit);
+        posY = _mm256_blendv_ps(posY, floor, hit);
+
+        // Gravity
+        __m256 accX = _mm256_add_ps(_mm256_loadu_ps(pax + i), _mm256_mul_ps(_mm256_mul_ps(gx, m), im));
+        __m256 accY = _mm256_add_ps(_mm256_loadu_ps(pay + i), _mm256_mul_ps(_mm256_mul_ps(gy, m), im));
+        __m256 accZ = _mm256_add_ps(_mm256_loadu_ps(paz + i), _mm256_mul_ps(_mm256_mul_ps(gz, m), im));
+
+        // Quadratic resistance, x-velocity snaps to zero below the threshold
+        __m256 absX = _mm256_andnot_ps(signMask, velX);
+        __m256 keepX = _mm256_cmp_ps(absX, thresholdX, _CMP_GT_OQ);
+        __m256 dragX = _mm256_xor_ps(signMask, _mm256_mul_ps(_mm256_mul_ps(rx, absX), velX));
+        accX = _mm256_blendv_ps(accX, _mm256_add_ps(accX, _mm256_mul_ps(dragX, im)), keepX);
+        velX = _mm256_and_ps(keepX, velX);
+
+        __m256 dragY = _mm256_xor_ps(signMask, _mm256_mul_ps(_mm256_mul_ps(ry, _mm256_andnot_ps(signMask, velY)), velY));
+        __m256 dragZ = _mm256_xor_ps(signMask, _mm256_mul_ps(_mm256_mul_ps(rz, _mm256_andnot_ps(signMask, velZ)), velZ));
+        accY = _mm256_add_ps(accY, _mm256_mul_ps(dragY, im));
+        accZ = _mm256_add_ps(accZ, _mm256_mul_ps(dragZ, im));
+
+        // Integrate
+        __m256 stepX = _mm256_mul_ps(vdt, _mm256_mul_ps(vdt, _mm256_mul_ps(half, accX)));
+        __m256 stepY = _mm256_mul_ps(vdt, _mm256_mul_ps(vdt, _mm256_mul_ps(half, accY)));
+        __m256 stepZ = _mm256_mul_ps(vdt, _mm256_mul_ps(vdt, _mm256_mul_ps(half, accZ)));
+        _mm256_storeu_ps(px + i, _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(px + i), stepX), _mm256_mul_ps(vdt, velX)));
+        _mm256_storeu_ps(py + i, _mm256_add_ps(_mm256_add_ps(posY, stepY), _mm256_mul_ps(vdt, velY)));
+        _mm256_storeu_ps(pz + i, _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(pz + i), stepZ), _mm256_mul_ps(vdt, velZ)));
+        _mm256_storeu_ps(pvx + i, _mm256_add_ps(velX, _mm256_mul_ps(vdt, accX)));
+        _mm256_storeu_ps(pvy + i, _mm256_add_ps(velY, _mm256_mul_ps(vdt, accY)));
+        _mm256_storeu_ps(pvz + i, _mm256_add_ps(velZ, _mm256_mul_ps(vdt, accZ)));
+        _mm256_storeu_ps(pax + i, zero);
+        _mm256_storeu_ps(pay + i, zero);
+        _mm256_storeu_ps(paz + i, zero);
+    }
+
+    updateRangeScalar(i, end, dt);
+}
+
+#else
+
+void PhysicsWorld::updateRangeAVX2(size_t begin, size_t end, float dt)
+{
+    updateRangeSSE(begin, end, dt);
+}
+
+#endif // SPHERE_HAS_AVX2
@@ -0,0 +1,122 @@
+#include "ProgramCache.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Cache file layout (native byte order):
+//   ProgramCacheHeader
+//   binary (binarySize bytes, in binaryFormat)
+namespace {
+
+struct ProgramCacheHeader {
+    char magic[4];        // "SPGB"
+    uint32_t version;
+    uint64_t sourceHash;  // hashShaderText of the definitions and both shaders
+    uint64_t driverHash;  // hashShaderText of GL_VENDOR, GL_RENDERER and GL_VERSION
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+const char cacheMagic[4] = { 'S', 'P', 'G', 'B' };
+
+uint64_t driverHash() {
+    static uint64_t hash = 0;
+    if (hash == 0) {
+        const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        hash = hashShaderText("", 0);
+        for (int i = 0; i < 3; ++i) {
+            const char* value = (const char*)glGetString(names[i]);
+            if (value) hash = hashShaderText(value, std::strlen(value) + 1, hash); // The terminator separates the strings
+        }
+    }
+    return hash;
+}
+
+} // namespace
+
+bool programBinariesSupported()
+{
+    static int supported = -1; // Unknown until the first call, which needs the context
+    if (supported < 0) {
+        GLint formats = 0;
+        if (GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = formats > 0 ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+uint64_t hashShaderText(const char* text, size_t size, uint64_t seed)
+{
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string programCachePath(const char* vertexShaderFile, const char* fragmentShaderFile, const char* definitions)
+{
+    // Variants of the same shader pair differ only in their definitions
+    uint64_t name = hashShaderText(fragmentShaderFile, std::strlen(fragmentShaderFile) + 1);
+    name = hashShaderText(definitions, std::strlen(definitions), name);
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.progcache", (unsigned long long)name);
+    return std::string(vertexShaderFile) + suffix;
+}
+
+GLuint loadProgramBinary(const std::string& path, uint64_t sourceHash)
+{
+    if (!programBinariesSupported()) return 0;
+
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(ProgramCacheHeader)) return 0;
+    ProgramCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, cacheMagic, 4) != 0 || header.version != programCacheVersion ||
+        header.sourceHash != sourceHash || header.driverHash != driverHash() ||
+        file.size() - sizeof(header) < header.binarySize) {
+        return 0;
+    }
+
+    // The driver may still reject a binary it wrote (e.g. after a silent
+    // update that kept the version string); that is a miss too
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, file.data() + sizeof(header), (GLsizei)header.binarySize);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool saveProgramBinary(const std::string& path, uint64_t sourceHash, GLuint program)
+{
+    if (!programBinariesSupported()) return false;
+
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) return false;
+    std::vector<char> binary((size_t)size);
+    GLenum binaryFormat = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, size, &written, &binaryFormat, binary.data());
+    if (written <= 0) return false;
+
+    ProgramCacheHeader header;
+    std::memcpy(header.magic, cacheMagic, 4);
+    header.version = programCacheVersion;
+    header.sourceHash = sourceHash;
+    header.driverHash = driverHash();
+    header.binaryFormat = binaryFormat;
+    header.binarySize = (uint32_t)written;
+
+    std::vector<FileChunk> chunks;
+    chunks.push_back(FileChunk{ &header, sizeof(header) });
+    chunks.push_back(FileChunk{ binary.data(), (size_t)written });
+    return writeFileAtomically(path, chunks);
+}
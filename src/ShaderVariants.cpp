@@ -0,0 +1,76 @@
+#include "ShaderVariants.h"
+#include "UniformBlocks.h"
+#include <iostream>
+
+ShaderVariants::ShaderVariants()
+{
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    // Programs must already be gone (clear()); the context may not exist any more
+}
+
+void ShaderVariants::init(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+    vertexFile = vertexShaderFile;
+    fragmentFile = fragmentShaderFile;
+}
+
+ShaderVariantKey ShaderVariants::normalize(ShaderVariantKey key)
+{
+    if (key.shadowPass) {
+        key.shadingMode = 1;
+        key.texture = ShaderTexture::None;
+    } else if (key.texture != ShaderTexture::None) {
+        key.shadingMode = 1;
+    }
+    return key;
+}
+
+unsigned ShaderVariants::packKey(const ShaderVariantKey& key)
+{
+    return (unsigned)key.shadingMode | ((unsigned)key.texture << 1) | ((unsigned)key.shadowPass << 3);
+}
+
+const ShaderVariant& ShaderVariants::get(const ShaderVariantKey& requested)
+{
+    const ShaderVariantKey key = normalize(requested);
+    const unsigned packed = packKey(key);
+    std::unordered_map<unsigned, ShaderVariant>::iterator found = variants.find(packed);
+    if (found != variants.end()) return found->second;
+
+    std::string definitions =
+        "#define SHADING_MODE " + std::to_string(key.shadingMode) + "\n"
+        "#define TEXTURE_MODE " + std::to_string((int)key.texture) + "\n"
+        "#define SHADOW_PASS " + std::to_string(key.shadowPass ? 1 : 0) + "\n";
+
+    ShaderVariant variant;
+    bool fromCache = false;
+    variant.program = InitShader(vertexFile.c_str(), fragmentFile.c_str(), definitions.c_str(), &fromCache);
+    if (!fromCache) {
+        std::cout << "Compiled shader variant " << packed << " (shading " << key.shadingMode
+                  << ", texture " << (int)key.texture << ", shadow " << key.shadowPass << ")" << std::endl;
+    }
+    bindUniformBlocks(variant.program);
+    variant.shadowMatrix = glGetUniformLocation(variant.program, "u_ShadowMatrix");
+    variant.shadowColor = glGetUniformLocation(variant.program, "u_shadowColor");
+    variant.texturePlane = glGetUniformLocation(variant.program, "u_1DTexturePlane");
+    variant.stripeScale = glGetUniformLocation(variant.program, "u_1DTextureStripeScale");
+
+    // Sampler units never change, so they are set once here (InitShader left the program bound)
+    GLint sampler2D = glGetUniformLocation(variant.program, "textureSampler2D");
+    GLint sampler1D = glGetUniformLocation(variant.program, "textureSampler1D");
+    if (sampler2D != -1) glUniform1i(sampler2D, 0);
+    if (sampler1D != -1) glUniform1i(sampler1D, 1);
+
+    return variants[packed] = variant;
+}
+
+void ShaderVariants::clear()
+{
+    for (std::unordered_map<unsigned, ShaderVariant>::iterator it = variants.begin(); it != variants.end(); ++it) {
+        glDeleteProgram(it->second.program);
+    }
+    variants.clear();
+}
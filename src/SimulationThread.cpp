@@ -0,0 +1,158 @@
+#include "SimulationThread.h"
+#include "PhysicsWorld.h"
+#include "JobSystem.h"
+
+typedef std::chrono::steady_clock Clock;
+
+SimulationThread::SimulationThread()
+{
+    maxStepsPerBatch = 8;
+    world = nullptr;
+    jobs = nullptr;
+    timeStep = 1.0 / 120.0;
+    rotationAxis = 1;
+    rotationSpeed = 0.0f;
+    for (int i = 0; i < 3; ++i) theta[i] = previousTheta[i] = 0.0f;
+    stepCount = 0;
+    spawnSeed = 1;
+    running = false;
+}
+
+SimulationThread::~SimulationThread()
+{
+    stop();
+}
+
+void SimulationThread::start(PhysicsWorld& physicsWorld, JobSystem* jobSystem, double step, int axis, float speed)
+{
+    stop();
+    world = &physicsWorld;
+    jobs = jobSystem;
+    timeStep = step;
+    rotationAxis = axis;
+    rotationSpeed = speed;
+
+    // Publish the initial state so the renderer never sees an empty snapshot
+    publish();
+    acquireSnapshot();
+
+    running = true;
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+    running = false;
+    if (thread.joinable()) thread.join();
+}
+
+bool SimulationThread::sendCommand(const SimulationCommand& command)
+{
+    return commands.push(command);
+}
+
+const SimulationSnapshot& SimulationThread::acquireSnapshot()
+{
+    snapshots.update();
+    return snapshots.readBuffer();
+}
+
+float SimulationThread::interpolationAlpha(const SimulationSnapshot& snapshot) const
+{
+    double elapsed = std::chrono::duration<double>(Clock::now() - snapshot.stepTime).count();
+    float alpha = (float)(elapsed / timeStep);
+    if (alpha < 0.0f) alpha = 0.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+    return alpha;
+}
+
+void SimulationThread::run()
+{
+    const Clock::duration stepDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeStep));
+    Clock::time_point nextStep = Clock::now() + stepDuration;
+
+    while (running.load(std::memory_order_relaxed)) {
+        applyCommands();
+
+        // Take every step that is due; after a stall drop the backlog
+        // instead of trying to catch up
+        int steps = 0;
+        while (Clock::now() >= nextStep && steps < maxStepsPerBatch) {
+            step();
+            nextStep += stepDuration;
+            ++steps;
+        }
+        if (steps == maxStepsPerBatch) nextStep = Clock::now() + stepDuration;
+        if (steps > 0) publish();
+
+        std::this_thread::sleep_until(nextStep);
+    }
+}
+
+void SimulationThread::applyCommands()
+{
+    SimulationCommand command;
+    while (commands.pop(command)) {
+        switch (command.type) {
+        case SimulationCommandType::ResetBody:
+            if (command.body >= world->size()) break;
+            world->setPosition(command.body, command.position);
+            world->setVelocity(command.body, command.velocity);
+            world->resetAcceleration(command.body);
+            break;
+        case SimulationCommandType::SpawnBodies:
+            spawnBodies(command);
+            break;
+        }
+    }
+}
+
+void SimulationThread::spawnBodies(const SimulationCommand& command)
+{
+    // Scatter the bodies through a box around position, roughly one diameter
+    // apart so they do not all start out overlapping
+    const float side = std::cbrt((float)command.count) * command.radius * 2.0f;
+    world->reserve(world->size() + command.count);
+    for (size_t i = 0; i < command.count; ++i) {
+        float offset[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            spawnSeed = spawnSeed * 1664525u + 1013904223u;
+            offset[axis] = ((float)(spawnSeed >> 8) / 16777216.0f - 0.5f) * side;
+        }
+        vec3 position = command.position + vec3(offset[0], offset[1], offset[2]);
+        world->addBody(position, command.velocity, 1.0f, command.radius);
+    }
+}
+
+void SimulationThread::step()
+{
+    world->update(timeStep, jobs);
+
+    for (int i = 0; i < 3; ++i) previousTheta[i] = theta[i];
+    float& angle = theta[rotationAxis];
+    angle += rotationSpeed * (float)timeStep;
+    if (angle > 360.0f) angle -= 360.0f;
+    else if (angle < 0.0f) angle += 360.0f;
+    ++stepCount;
+}
+
+void SimulationThread::publish()
+{
+    SimulationSnapshot& snapshot = snapshots.writeBuffer();
+    const size_t count = world->size();
+    snapshot.previousPositions.resize(count);
+    snapshot.positions.resize(count);
+    // Radii never change, so a buffer only needs them again when bodies were added
+    if (snapshot.radii.size() != count) snapshot.radii.assign(world->radius.begin(), world->radius.end());
+    for (size_t i = 0; i < count; ++i) {
+        snapshot.previousPositions[i] = vec3(world->prevX[i], world->prevY[i], world->prevZ[i]);
+        snapshot.positions[i] = world->getPosition(i);
+    }
+    for (int i = 0; i < 3; ++i) {
+        snapshot.previousTheta[i] = previousTheta[i];
+        snapshot.theta[i] = theta[i];
+    }
+    snapshot.stepTime = Clock::now();
+    snapshot.stepCount = stepCount;
+    snapshots.publish();
+}
@@ -0,0 +1,280 @@
+#include "SphereGenerators.h"
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+
+const float axisEpsilon = 1e-6f;
+
+uint64_t edgeKey(GLuint a, GLuint b) {
+    if (a > b) std::swap(a, b);
+    return ((uint64_t)a << 32) | b;
+}
+
+// Same parameterization as SphereMesh's UV sphere: u = phi / 2pi, v = 1 - theta / pi
+float longitudeOf(const vec3& direction) {
+    float u = std::atan2(direction.z, direction.x) / (2.0f * float(M_PI));
+    return u < 0.0f ? u + 1.0f : u;
+}
+
+float latitudeOf(const vec3& direction) {
+    float y = direction.y < -1.0f ? -1.0f : (direction.y > 1.0f ? 1.0f : direction.y);
+    return 1.0f - std::acos(y) / float(M_PI);
+}
+
+// Longitude is undefined on the y axis
+bool isPole(const vec3& direction) {
+    return std::fabs(direction.x) < axisEpsilon && std::fabs(direction.z) < axisEpsilon;
+}
+
+// The half plane z = 0, x > 0, where u wraps from 1 back to 0
+bool onSeam(const vec3& direction) {
+    return std::fabs(direction.z) < axisEpsilon && direction.x > 0.0f;
+}
+
+} // namespace
+
+void generateIcosphere(int subdivisions, SphereGeometry& geometry)
+{
+    const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+    const float corners[12][3] = {
+        { -1,  t,  0 }, {  1,  t,  0 }, { -1, -t,  0 }, {  1, -t,  0 },
+        {  0, -1,  t }, {  0,  1,  t }, {  0, -1, -t }, {  0,  1, -t },
+        {  t,  0, -1 }, {  t,  0,  1 }, { -t,  0, -1 }, { -t,  0,  1 }
+    };
+    const GLuint faces[20][3] = {
+        { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+        { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+        { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+        { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+    };
+
+    std::vector<vec3>& directions = geometry.directions;
+    std::vector<GLuint>& indices = geometry.indices;
+    directions.clear();
+    geometry.texCoords.clear();
+    // Euler: V = 10 * 4^s + 2, all of them created below
+    directions.reserve(10 * ((size_t)1 << (2 * subdivisions)) + 2);
+    for (int i = 0; i < 12; ++i) directions.push_back(normalize(vec3(corners[i][0], corners[i][1], corners[i][2])));
+    indices.assign(&faces[0][0], &faces[0][0] + 60);
+
+    std::unordered_map<uint64_t, GLuint> midpoints;
+    std::vector<GLuint> finer;
+    for (int s = 0; s < subdivisions; ++s) {
+        // Each edge is shared by two triangles, so every midpoint is looked up twice
+        midpoints.clear();
+        midpoints.reserve(indices.size() / 2);
+        auto midpoint = [&](GLuint a, GLuint b) -> GLuint {
+            std::pair<std::unordered_map<uint64_t, GLuint>::iterator, bool> inserted =
+                midpoints.insert(std::make_pair(edgeKey(a, b), (GLuint)directions.size()));
+            if (inserted.second) directions.push_back(normalize(directions[a] + directions[b]));
+            return inserted.first->second;
+        };
+
+        finer.clear();
+        finer.reserve(indices.size() * 4);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            GLuint a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            GLuint ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            const GLuint split[12] = { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca };
+            finer.insert(finer.end(), split, split + 12);
+        }
+        indices.swap(finer);
+    }
+}
+
+void generateCubeSphere(int divisions, SphereGeometry& geometry)
+{
+    if (divisions < 2) divisions = 2;
+    if (divisions % 2 != 0) ++divisions;
+    const int n = divisions;
+
+    std::vector<vec3>& directions = geometry.directions;
+    std::vector<GLuint>& indices = geometry.indices;
+    directions.clear();
+    geometry.texCoords.clear();
+    indices.clear();
+    directions.reserve((size_t)6 * n * n + 2);
+    indices.reserve((size_t)36 * n * n);
+
+    // Faces meet on the lattice points of the cube's surface; keying vertices
+    // by lattice point shares them across face edges and corners
+    std::unordered_map<uint64_t, GLuint> latticeVertices;
+    auto vertexAt = [&](const int p[3]) -> GLuint {
+        uint64_t key = ((uint64_t)p[0] * (n + 1) + p[1]) * (n + 1) + p[2];
+        std::pair<std::unordered_map<uint64_t, GLuint>::iterator, bool> inserted =
+            latticeVertices.insert(std::make_pair(key, (GLuint)directions.size()));
+        if (inserted.second) {
+            float x = 2.0f * p[0] / n - 1.0f, y = 2.0f * p[1] / n - 1.0f, z = 2.0f * p[2] / n - 1.0f;
+            float x2 = x * x, y2 = y * y, z2 = z * z;
+            directions.push_back(vec3(x * std::sqrt(1.0f - 0.5f * (y2 + z2) + y2 * z2 / 3.0f),
+                                      y * std::sqrt(1.0f - 0.5f * (z2 + x2) + z2 * x2 / 3.0f),
+                                      z * std::sqrt(1.0f - 0.5f * (x2 + y2) + x2 * y2 / 3.0f)));
+        }
+        return inserted.first->second;
+    };
+
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int side = 0; side < 2; ++side) {
+            // e[axis + 1] x e[axis + 2] = e[axis], so (right, up) runs
+            // counter-clockwise seen from outside the positive face; the
+            // negative face swaps them
+            int right = (axis + 1) % 3, up = (axis + 2) % 3;
+            if (side == 0) std::swap(right, up);
+            int p[3];
+            p[axis] = side == 0 ? 0 : n;
+            for (int j = 0; j < n; ++j) {
+                for (int i = 0; i < n; ++i) {
+                    GLuint quad[4];
+                    p[right] = i;     p[up] = j;     quad[0] = vertexAt(p);
+                    p[right] = i + 1;                quad[1] = vertexAt(p);
+                                      p[up] = j + 1; quad[2] = vertexAt(p);
+                    p[right] = i;                    quad[3] = vertexAt(p);
+                    const GLuint split[6] = { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] };
+                    indices.insert(indices.end(), split, split + 6);
+                }
+            }
+        }
+    }
+}
+
+void addSphereTexCoords(SphereGeometry& geometry)
+{
+    std::vector<vec3>& directions = geometry.directions;
+    std::vector<vec2>& texCoords = geometry.texCoords;
+    texCoords.resize(directions.size());
+    for (size_t i = 0; i < directions.size(); ++i) {
+        const vec3& d = directions[i];
+        float u = isPole(d) || onSeam(d) ? 0.0f : longitudeOf(d);
+        texCoords[i] = vec2(u, latitudeOf(d));
+    }
+
+    auto addVertex = [&](const vec3& direction, const vec2& texCoord) -> GLuint {
+        directions.push_back(direction);
+        texCoords.push_back(texCoord);
+        return (GLuint)directions.size() - 1;
+    };
+
+    // A seam vertex is used at u = 0 by triangles east of the seam and at
+    // u = 1 by those west of it; the u = 1 copy is made on first use
+    std::unordered_map<GLuint, GLuint> seamCopies;
+    auto seamCopy = [&](GLuint vertex) -> GLuint {
+        std::unordered_map<GLuint, GLuint>::iterator found = seamCopies.find(vertex);
+        if (found != seamCopies.end()) return found->second;
+        vec3 direction = directions[vertex];
+        float v = texCoords[vertex].y;
+        return seamCopies[vertex] = addVertex(direction, vec2(1.0f, v));
+    };
+
+    // Where an edge crosses the seam, a new vertex is made at u = 0 followed
+    // by its u = 1 copy. Both triangles of the edge share them, so the split
+    // leaves no cracks.
+    std::unordered_map<uint64_t, GLuint> seamSplits;
+    auto seamSplit = [&](GLuint a, GLuint b) -> GLuint {
+        std::unordered_map<uint64_t, GLuint>::iterator found = seamSplits.find(edgeKey(a, b));
+        if (found != seamSplits.end()) return found->second;
+        vec3 from = directions[a], to = directions[b];
+        vec3 crossing = from + (to - from) * (from.z / (from.z - to.z));
+        crossing = normalize(vec3(crossing.x, crossing.y, 0.0f));
+        GLuint vertex = addVertex(crossing, vec2(0.0f, latitudeOf(crossing)));
+        addVertex(crossing, vec2(1.0f, latitudeOf(crossing)));
+        return seamSplits[edgeKey(a, b)] = vertex;
+    };
+
+    const std::vector<GLuint>& indices = geometry.indices;
+    std::vector<GLuint> output;
+    output.reserve(indices.size() + indices.size() / 8);
+    auto emitFan = [&](const GLuint* polygon, int count) {
+        for (int k = 1; k + 1 < count; ++k) {
+            GLuint a = polygon[0], b = polygon[k], c = polygon[k + 1];
+            if (a == b || b == c || c == a) continue;
+            output.push_back(a);
+            output.push_back(b);
+            output.push_back(c);
+        }
+    };
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const GLuint* triangle = &indices[i];
+        float minU = 1.0f, maxU = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            if (isPole(directions[triangle[k]])) continue;
+            float u = texCoords[triangle[k]].x;
+            if (u < minU) minU = u;
+            if (u > maxU) maxU = u;
+        }
+        if (maxU - minU <= 0.5f) {
+            output.insert(output.end(), triangle, triangle + 3);
+            continue;
+        }
+
+        // Clip the triangle against the seam into an east (u near 0) and a
+        // west (u near 1) polygon, keeping the winding
+        GLuint east[6], west[6];
+        int eastCount = 0, westCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            GLuint a = triangle[k], b = triangle[(k + 1) % 3];
+            bool aFixed = isPole(directions[a]) || onSeam(directions[a]);
+            bool bFixed = isPole(directions[b]) || onSeam(directions[b]);
+            bool aEast = texCoords[a].x < 0.5f;
+            if (isPole(directions[a])) {
+                east[eastCount++] = a;
+                west[westCount++] = a;
+            } else if (onSeam(directions[a])) {
+                east[eastCount++] = a;
+                west[westCount++] = seamCopy(a);
+            } else if (aEast) {
+                east[eastCount++] = a;
+            } else {
+                west[westCount++] = a;
+            }
+            if (!aFixed && !bFixed && aEast != (texCoords[b].x < 0.5f)) {
+                GLuint split = seamSplit(a, b);
+                east[eastCount++] = split;
+                west[westCount++] = split + 1;
+            }
+        }
+        emitFan(east, eastCount);
+        emitFan(west, westCount);
+    }
+    geometry.indices.swap(output);
+
+    // Give each triangle its own copy of a pole vertex, halfway between the
+    // longitudes of its other two corners, as the UV sphere's pole row does
+    std::vector<GLuint>& split = geometry.indices;
+    for (size_t i = 0; i < split.size(); i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            GLuint pole = split[i + k];
+            if (!isPole(directions[pole])) continue;
+            float u = 0.5f * (texCoords[split[i + (k + 1) % 3]].x + texCoords[split[i + (k + 2) % 3]].x);
+            vec3 direction = directions[pole];
+            float v = texCoords[pole].y;
+            split[i + k] = addVertex(direction, vec2(u, v));
+        }
+    }
+}
+
+float sphereGeometryError(const SphereGeometry& geometry)
+{
+    // A flat triangle strays furthest from the sphere at its point nearest
+    // the centre, which for these near-equilateral triangles is the foot of
+    // the perpendicular from the centre to its plane
+    const std::vector<vec3>& directions = geometry.directions;
+    const std::vector<GLuint>& indices = geometry.indices;
+    float error = 0.0f;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const vec3& a = directions[indices[i]];
+        vec3 normal = cross(directions[indices[i + 1]] - a, directions[indices[i + 2]] - a);
+        float area = length(normal);
+        if (area < 1e-12f) continue;
+        float distance = dot(normal, a) / area;
+        if (1.0f - distance > error) error = 1.0f - distance;
+    }
+    return error;
+}
@@ -0,0 +1,147 @@
+#include "SphereInstances.h"
+#include "FrameRingBuffer.h"
+#include "JobSystem.h"
+#include "SimulationThread.h"
+
+SphereInstances::SphereInstances()
+{
+    parallelGrainSize = 4096;
+    maxScreenError = 1.0f;
+    lodHysteresis = 0.8f;
+    vao = 0;
+    firstLocation = 0;
+    buffer = 0;
+    bufferOffset = 0;
+    count = 0;
+}
+
+void SphereInstances::init(GLuint sphereVAO, GLuint location)
+{
+    vao = sphereVAO;
+    firstLocation = location;
+
+    glBindVertexArray(vao);
+    for (GLuint i = 0; i < 5; ++i) {
+        glEnableVertexAttribArray(firstLocation + i);
+        glVertexAttribDivisor(firstLocation + i, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void SphereInstances::setLodErrors(const std::vector<float>& errors)
+{
+    lodErrors = errors;
+    lodOfBody.clear();
+}
+
+bool SphereInstances::build(const SimulationSnapshot& snapshot, float alpha, const mat4& rotation, float meshRadius,
+                            const std::vector<int>& materials, const std::vector<TextureSlot>& textures,
+                            const mat4& view, float pixelsPerUnit, FrameRingBuffer& ring, JobSystem* jobs)
+{
+    batches.clear();
+    count = snapshot.positions.size();
+    SphereInstance* instances = (SphereInstance*)ring.allocate(count * sizeof(SphereInstance), sizeof(GLfloat) * 4, bufferOffset);
+    if (!instances) {
+        count = 0;
+        return false;
+    }
+    buffer = ring.getBuffer();
+    bodyOfSlot.resize(count);
+
+    // Pick each body's level from its projected radius: the coarsest level whose
+    // silhouette error stays under maxScreenError pixels, starting from last
+    // frame's level. Bodies added since then start at the finest level.
+    const int levels = (int)lodErrors.size();
+    lodOfBody.resize(levels > 1 ? count : 0, 0);
+    auto selectLods = [&](size_t begin, size_t end) {
+        const float coarserError = maxScreenError * lodHysteresis;
+        for (size_t i = begin; i < end; ++i) {
+            const vec3& from = snapshot.previousPositions[i];
+            vec3 p = from + (snapshot.positions[i] - from) * alpha;
+            float depth = -(view[2][0] * p.x + view[2][1] * p.y + view[2][2] * p.z + view[2][3]);
+            float radius = snapshot.radii[i];
+            if (depth <= radius) { // The camera is inside or beside the sphere
+                lodOfBody[i] = 0;
+                continue;
+            }
+            float radiusPixels = radius * pixelsPerUnit / depth;
+            int level = lodOfBody[i];
+            while (level > 0 && lodErrors[level] * radiusPixels > maxScreenError) --level;
+            while (level + 1 < levels && lodErrors[level + 1] * radiusPixels <= coarserError) ++level;
+            lodOfBody[i] = (uint8_t)level;
+        }
+    };
+    if (jobs && lodOfBody.size() > parallelGrainSize) {
+        jobs->parallelFor(0, lodOfBody.size(), parallelGrainSize, selectLods);
+    } else {
+        selectLods(0, lodOfBody.size());
+    }
+
+    // Group bodies by level and texture array with a counting sort; there are
+    // only a handful of each, so the batch lookup is a linear search
+    batchOfBody.resize(textures.empty() && lodOfBody.empty() ? 0 : count);
+    for (size_t i = 0; i < batchOfBody.size(); ++i) {
+        int lod = lodOfBody.empty() ? 0 : lodOfBody[i];
+        GLuint textureArray = textures.empty() ? 0 : textures[i].array;
+        size_t b = 0;
+        while (b < batches.size() && (batches[b].lod != lod || batches[b].textureArray != textureArray)) ++b;
+        if (b == batches.size()) batches.push_back(SphereBatch{ lod, textureArray, 0, 0 });
+        ++batches[b].count;
+        batchOfBody[i] = (uint32_t)b;
+    }
+    if (batches.empty()) batches.push_back(SphereBatch{ 0, 0, 0, count });
+    for (size_t b = 1; b < batches.size(); ++b) batches[b].first = batches[b - 1].first + batches[b - 1].count;
+    if (batchOfBody.empty()) {
+        for (size_t i = 0; i < count; ++i) bodyOfSlot[i] = (uint32_t)i;
+    } else {
+        std::vector<size_t> next(batches.size()); // Next free slot of each batch
+        for (size_t b = 0; b < batches.size(); ++b) next[b] = batches[b].first;
+        for (size_t i = 0; i < count; ++i) bodyOfSlot[next[batchOfBody[i]]++] = (uint32_t)i;
+    }
+
+    // The target may be write-combined GPU memory, so the loop runs over
+    // instance slots and writes each one whole, in order; the gather is on
+    // the reads from the snapshot instead
+    auto fill = [&](size_t begin, size_t end) {
+        for (size_t slot = begin; slot < end; ++slot) {
+            const size_t i = bodyOfSlot[slot];
+            const vec3& from = snapshot.previousPositions[i];
+            vec3 p = from + (snapshot.positions[i] - from) * alpha;
+            float scale = snapshot.radii[i] / meshRadius;
+
+            // Translate(p) * rotation * Scale(scale), written column by column
+            SphereInstance& instance = instances[slot];
+            for (int column = 0; column < 3; ++column) {
+                for (int row = 0; row < 3; ++row) instance.model[column * 4 + row] = rotation[row][column] * scale;
+                instance.model[column * 4 + 3] = 0.0f;
+            }
+            instance.model[12] = p.x;
+            instance.model[13] = p.y;
+            instance.model[14] = p.z;
+            instance.model[15] = 1.0f;
+            instance.materialIndex = i < materials.size() ? (GLfloat)materials[i] : 0.0f;
+            instance.textureLayer = i < textures.size() ? (GLfloat)textures[i].layer : 0.0f;
+            instance.padding[0] = instance.padding[1] = 0.0f;
+        }
+    };
+    if (jobs && count > parallelGrainSize) {
+        jobs->parallelFor(0, count, parallelGrainSize, fill);
+    } else {
+        fill(0, count);
+    }
+    return true;
+}
+
+void SphereInstances::bindBatch(const SphereBatch& batch) const
+{
+    // GL 3.3 has no base instance, so the attribute offsets select the batch
+    const size_t base = bufferOffset + batch.first * sizeof(SphereInstance);
+    const GLsizei stride = sizeof(SphereInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint column = 0; column < 4; ++column) {
+        glVertexAttribPointer(firstLocation + column, 4, GL_FLOAT, GL_FALSE, stride,
+                              (void*)(base + column * 4 * sizeof(GLfloat)));
+    }
+    glVertexAttribPointer(firstLocation + 4, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SphereInstance, materialIndex)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
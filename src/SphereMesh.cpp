@@ -0,0 +1,296 @@
+#include "SphereMesh.h"
+#include "JobSystem.h"
+#include "MeshOptimizer.h"
+#include "SphereGenerators.h"
+#include "SphereMeshTables.h"
+#include <cmath>
+#include <cstddef>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+
+#if SPHERE_PACKED_VERTICES
+GLshort toSnorm16(float value) {
+    value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return (GLshort)std::lround(value * 32767.0f);
+}
+
+GLushort toUnorm16(float value) {
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (GLushort)std::lround(value * 65535.0f);
+}
+
+GLuint toSnorm10(float value) {
+    value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return (GLuint)std::lround(value * 511.0f) & 0x3ffu;
+}
+#endif
+
+// The farthest point of a face from the sphere is its centre: half a
+// latitude step and half a longitude step away from the vertices
+float uvSphereError(int bands) {
+    return 1.0f - std::cos(float(M_PI) / (2 * bands)) * std::cos(float(M_PI) / bands);
+}
+
+} // namespace
+
+SphereVertex packSphereVertex(const vec3& direction, const vec2& texCoord)
+{
+    SphereVertex vertex;
+#if SPHERE_PACKED_VERTICES
+    vertex.position[0] = toSnorm16(direction.x);
+    vertex.position[1] = toSnorm16(direction.y);
+    vertex.position[2] = toSnorm16(direction.z);
+    vertex.position[3] = 0;
+    vertex.normal = toSnorm10(direction.x) | (toSnorm10(direction.y) << 10) | (toSnorm10(direction.z) << 20);
+    vertex.texCoord[0] = toUnorm16(texCoord.x);
+    vertex.texCoord[1] = toUnorm16(texCoord.y);
+#else
+    vertex.position[0] = vertex.normal[0] = direction.x;
+    vertex.position[1] = vertex.normal[1] = direction.y;
+    vertex.position[2] = vertex.normal[2] = direction.z;
+    vertex.texCoord[0] = texCoord.x;
+    vertex.texCoord[1] = texCoord.y;
+#endif
+    return vertex;
+}
+
+SphereMesh::SphereMesh()
+{
+    vao = 0;
+    vertexBuffer = 0;
+    indexBuffer = 0;
+    indexType = GL_UNSIGNED_INT;
+    topology = SphereTopology::UVSphere;
+}
+
+void SphereMesh::generate(SphereTopology meshTopology, const std::vector<int>& levelDetail, JobSystem* jobs)
+{
+    topology = meshTopology;
+    lods.resize(levelDetail.size());
+    if (topology == SphereTopology::UVSphere && useTables(levelDetail)) return;
+
+    if (topology == SphereTopology::UVSphere) {
+        // Lay the levels out back to back first, so each can be filled independently
+        size_t vertexCount = 0, indexCount = 0;
+        for (size_t level = 0; level < lods.size(); ++level) {
+            SphereLod& lod = lods[level];
+            const int bands = levelDetail[level];
+            lod.detail = bands;
+            lod.baseVertex = (GLint)vertexCount;
+            lod.vertexCount = (size_t)(bands + 1) * (bands + 1);
+            lod.firstIndex = indexCount;
+            lod.indexCount = (GLsizei)(bands * bands * 6);
+            lod.relativeError = uvSphereError(bands);
+            lod.table = nullptr;
+            vertexCount += lod.vertexCount;
+            indexCount += (size_t)lod.indexCount;
+        }
+        vertices.resize(vertexCount);
+        indices.resize(indexCount);
+
+        for (size_t level = 0; level < lods.size(); ++level) {
+            generateUVLevel(lods[level], jobs);
+        }
+    } else {
+        generateGeometryLevels(levelDetail, jobs);
+    }
+
+    // Levels occupy disjoint ranges of both arrays, so they are optimized independently
+    auto optimizeLevels = [&](size_t begin, size_t end) {
+        for (size_t level = begin; level < end; ++level) optimizeLevel(lods[level]);
+    };
+    if (jobs) {
+        jobs->parallelFor(0, lods.size(), 1, optimizeLevels);
+    } else {
+        optimizeLevels(0, lods.size());
+    }
+}
+
+void SphereMesh::generateGeometryLevels(const std::vector<int>& levelDetail, JobSystem* jobs)
+{
+    // Sizes are only known once a level is built, so levels are built whole
+    // (one job each) and then appended
+    std::vector<SphereGeometry> geometries(lods.size());
+    auto generateLevels = [&](size_t begin, size_t end) {
+        for (size_t level = begin; level < end; ++level) {
+            if (topology == SphereTopology::Icosphere) {
+                generateIcosphere(levelDetail[level], geometries[level]);
+            } else {
+                generateCubeSphere(levelDetail[level], geometries[level]);
+            }
+            lods[level].relativeError = sphereGeometryError(geometries[level]);
+            addSphereTexCoords(geometries[level]);
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(0, lods.size(), 1, generateLevels);
+    } else {
+        generateLevels(0, lods.size());
+    }
+
+    vertices.clear();
+    indices.clear();
+    for (size_t level = 0; level < lods.size(); ++level) {
+        const SphereGeometry& geometry = geometries[level];
+        SphereLod& lod = lods[level];
+        lod.detail = levelDetail[level];
+        lod.baseVertex = (GLint)vertices.size();
+        lod.vertexCount = geometry.directions.size();
+        lod.firstIndex = indices.size();
+        lod.indexCount = (GLsizei)geometry.indices.size();
+        lod.table = nullptr;
+        for (size_t i = 0; i < geometry.directions.size(); ++i) {
+            vertices.push_back(packSphereVertex(geometry.directions[i], geometry.texCoords[i]));
+        }
+        indices.insert(indices.end(), geometry.indices.begin(), geometry.indices.end());
+    }
+}
+
+void SphereMesh::generateUVLevel(const SphereLod& lod, JobSystem* jobs)
+{
+    const int latitudeBands = lod.detail;
+    const int longitudeBands = lod.detail;
+    const size_t rowVertices = longitudeBands + 1;
+    SphereVertex* levelVertices = &vertices[lod.baseVertex];
+    GLuint* levelIndices = &indices[lod.firstIndex];
+
+    // Every latitude row writes its own slice of the arrays, so rows are independent jobs
+    auto generateRows = [&](size_t latBegin, size_t latEnd) {
+        for (int lat = (int)latBegin; lat < (int)latEnd; ++lat) {
+            float theta = lat * float(M_PI) / latitudeBands;
+            float sinTheta = std::sin(theta);
+            float cosTheta = std::cos(theta);
+            for (int lon = 0; lon <= longitudeBands; ++lon) {
+                float phi = lon * 2.0f * float(M_PI) / longitudeBands;
+                vec3 direction(std::cos(phi) * sinTheta, cosTheta, std::sin(phi) * sinTheta);
+                vec2 texCoord((float)lon / longitudeBands, 1.0f - (float)lat / latitudeBands);
+                levelVertices[lat * rowVertices + lon] = packSphereVertex(direction, texCoord);
+            }
+            if (lat == latitudeBands) continue;
+            for (int lon = 0; lon < longitudeBands; ++lon) {
+                GLuint first = (GLuint)(lat * rowVertices + lon);
+                GLuint second = first + (GLuint)rowVertices;
+                GLuint* quad = &levelIndices[(lat * longitudeBands + lon) * 6];
+                quad[0] = first;
+                quad[1] = second;
+                quad[2] = first + 1;
+                quad[3] = second;
+                quad[4] = second + 1;
+                quad[5] = first + 1;
+            }
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(0, latitudeBands + 1, 8, generateRows);
+    } else {
+        generateRows(0, latitudeBands + 1);
+    }
+}
+
+bool SphereMesh::useTables(const std::vector<int>& levelBands)
+{
+    for (size_t level = 0; level < levelBands.size(); ++level) {
+        if (!findSphereTable(levelBands[level])) return false;
+    }
+
+    // Nothing to compute or store: the tables are already in stripe order
+    // for the vertex cache and in first-use order for vertex fetch, and carry
+    // their error, so only the level ranges are filled in
+    std::vector<SphereVertex>().swap(vertices);
+    std::vector<GLuint>().swap(indices);
+    size_t vertexCount = 0, indexCount = 0;
+    for (size_t level = 0; level < lods.size(); ++level) {
+        const SphereTable* table = findSphereTable(levelBands[level]);
+        SphereLod& lod = lods[level];
+        lod.detail = table->bands;
+        lod.baseVertex = (GLint)vertexCount;
+        lod.vertexCount = table->vertexCount;
+        lod.firstIndex = indexCount;
+        lod.indexCount = (GLsizei)table->indexCount;
+        lod.relativeError = table->relativeError;
+        lod.table = table;
+        vertexCount += table->vertexCount;
+        indexCount += table->indexCount;
+    }
+    return true;
+}
+
+void SphereMesh::optimizeLevel(SphereLod& lod)
+{
+    GLuint* levelIndices = &indices[lod.firstIndex];
+    optimizeVertexCache(levelIndices, (size_t)lod.indexCount, lod.vertexCount);
+    std::vector<GLuint> remap = optimizeVertexFetch(levelIndices, (size_t)lod.indexCount, lod.vertexCount);
+    remapVertices(&vertices[lod.baseVertex], lod.vertexCount, remap);
+}
+
+void SphereMesh::upload()
+{
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    if (usesTables()) {
+        glBufferData(GL_ARRAY_BUFFER, getVertexCount() * sizeof(SphereVertex), nullptr, GL_STATIC_DRAW);
+        for (const SphereLod& lod : lods) {
+            glBufferSubData(GL_ARRAY_BUFFER, lod.baseVertex * sizeof(SphereVertex), lod.vertexCount * sizeof(SphereVertex), lod.table->vertices);
+        }
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SphereVertex), vertices.data(), GL_STATIC_DRAW);
+    }
+    const GLsizei stride = sizeof(SphereVertex);
+#if SPHERE_PACKED_VERTICES
+    glVertexAttribPointer(positionLocation, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(SphereVertex, position));
+    glVertexAttribPointer(normalLocation, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(SphereVertex, normal));
+    glVertexAttribPointer(texCoordLocation, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(SphereVertex, texCoord));
+#else
+    glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SphereVertex, position));
+    glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SphereVertex, normal));
+    glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SphereVertex, texCoord));
+#endif
+    glEnableVertexAttribArray(positionLocation);
+    glEnableVertexAttribArray(normalLocation);
+    glEnableVertexAttribArray(texCoordLocation);
+
+    // Constant colour: with its array disabled, vColor reads this current value
+    glDisableVertexAttribArray(colorLocation);
+    glVertexAttrib4f(colorLocation, 1.0f, 0.0f, 0.0f, 1.0f);
+
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer); // Part of the VAO's state
+    size_t largestLevel = 0;
+    for (size_t level = 0; level < lods.size(); ++level) {
+        if (lods[level].vertexCount > largestLevel) largestLevel = lods[level].vertexCount;
+    }
+    if (usesTables()) {
+        const SphereLod& last = lods.back();
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (last.firstIndex + last.indexCount) * sizeof(GLushort), nullptr, GL_STATIC_DRAW);
+        for (const SphereLod& lod : lods) {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, lod.firstIndex * sizeof(GLushort), lod.indexCount * sizeof(GLushort), lod.table->indices);
+        }
+        indexType = GL_UNSIGNED_SHORT;
+    } else if (largestLevel <= 0xffff) {
+        std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+        indexType = GL_UNSIGNED_SHORT;
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        indexType = GL_UNSIGNED_INT;
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void SphereMesh::destroy()
+{
+    if (vao != 0) glDeleteVertexArrays(1, &vao);
+    if (vertexBuffer != 0) glDeleteBuffers(1, &vertexBuffer);
+    if (indexBuffer != 0) glDeleteBuffers(1, &indexBuffer);
+    vao = vertexBuffer = indexBuffer = 0;
+}
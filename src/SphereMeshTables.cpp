@@ -0,0 +1,23 @@
+#include "SphereMeshTables.h"
+
+namespace {
+
+template <int Bands>
+SphereTable describeTable() {
+    typedef SphereMeshTable<Bands, Bands> Table;
+    return SphereTable{ Bands, &Table::vertices[0], Table::vertexCount, &Table::indices[0], Table::indexCount, Table::relativeError };
+}
+
+} // namespace
+
+const SphereTable* findSphereTable(int bands)
+{
+    // The UV levels main() uses; each adds its tables to the binary and to the build time
+    static const SphereTable tables[] = {
+        describeTable<50>(), describeTable<32>(), describeTable<20>(), describeTable<12>(), describeTable<8>()
+    };
+    for (const SphereTable& table : tables) {
+        if (table.bands == bands) return &table;
+    }
+    return nullptr;
+}
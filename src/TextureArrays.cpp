@@ -0,0 +1,109 @@
+#include "TextureArrays.h"
+
+namespace {
+
+GLenum compressedFormatOf(TextureFormat format) {
+    return format == TextureFormat::BC7 ? GL_COMPRESSED_RGBA_BPTC_UNORM : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+} // namespace
+
+TextureArrays::TextureArrays()
+{
+    layersPerArray = 8;
+}
+
+TextureArrays::~TextureArrays()
+{
+    // GL objects must already be gone (clear()); the context may not exist any more
+}
+
+TextureSlot TextureArrays::allocate(int width, int height, int levelCount, TextureFormat format)
+{
+    ArrayInfo* match = nullptr;
+    for (size_t i = 0; i < arrays.size() && !match; ++i) {
+        ArrayInfo& info = arrays[i];
+        if (info.width == width && info.height == height && info.levelCount == levelCount &&
+            info.format == format && !info.freeLayers.empty()) {
+            match = &info;
+        }
+    }
+    if (!match) match = &createArray(width, height, levelCount, format);
+
+    TextureSlot slot;
+    slot.array = match->texture;
+    slot.layer = match->freeLayers.back();
+    match->freeLayers.pop_back();
+    return slot;
+}
+
+void TextureArrays::release(const TextureSlot& slot)
+{
+    ArrayInfo* info = findArray(slot.array);
+    if (info) info->freeLayers.push_back(slot.layer);
+}
+
+void TextureArrays::upload(const TextureSlot& slot, int level, int width, int height, const void* pixels, size_t size)
+{
+    ArrayInfo* info = findArray(slot.array);
+    if (!info) return;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, slot.array);
+    if (info->format == TextureFormat::RGB8) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, slot.layer, width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    } else {
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, slot.layer, width, height, 1,
+                                  compressedFormatOf(info->format), (GLsizei)size, pixels);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArrays::clear()
+{
+    for (size_t i = 0; i < arrays.size(); ++i) {
+        glDeleteTextures(1, &arrays[i].texture);
+    }
+    arrays.clear();
+}
+
+TextureArrays::ArrayInfo* TextureArrays::findArray(GLuint texture)
+{
+    for (size_t i = 0; i < arrays.size(); ++i) {
+        if (arrays[i].texture == texture) return &arrays[i];
+    }
+    return nullptr;
+}
+
+TextureArrays::ArrayInfo& TextureArrays::createArray(int width, int height, int levelCount, TextureFormat format)
+{
+    ArrayInfo info;
+    info.width = width;
+    info.height = height;
+    info.levelCount = levelCount;
+    info.format = format;
+    // Hand out layer 0 first
+    for (int layer = layersPerArray; layer-- > 0;) info.freeLayers.push_back(layer);
+
+    glGenTextures(1, &info.texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, info.texture);
+    int w = width, h = height;
+    for (int level = 0; level < levelCount; ++level) {
+        if (format == TextureFormat::RGB8) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGB8, w, h, layersPerArray, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        } else {
+            GLsizei size = (GLsizei)(compressedLevelSize(w, h, format) * layersPerArray);
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, compressedFormatOf(format), w, h, layersPerArray, 0, size, nullptr);
+        }
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    arrays.push_back(info);
+    return arrays.back();
+}
@@ -0,0 +1,195 @@
+#include "TextureCache.h"
+#include "Mipmap.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+
+// Cache file layout (native byte order, the cache is never shared between machines):
+//   TextureCacheHeader
+//   TextureCacheLevel[levelCount]
+//   level data (RGB8 texels or BC1/BC7 blocks), each starting on a 16-byte boundary
+namespace {
+
+struct TextureCacheHeader {
+    char magic[4];        // "STXC"
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;   // Modification time of the source, seconds since the epoch
+    uint64_t sourceHash;  // FNV-1a of the source bytes
+    uint32_t levelCount;
+    uint32_t format;      // TextureFormat of the stored levels
+};
+
+struct TextureCacheLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+const char cacheMagic[4] = { 'S', 'T', 'X', 'C' };
+
+uint64_t hashBytes(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool hashFile(const std::string& path, uint64_t& hash) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    hash = hashBytes(file.data(), file.size());
+    return true;
+}
+
+} // namespace
+
+CachedTexture::CachedTexture()
+{
+    fromCache = false;
+    format = TextureFormat::RGB8;
+}
+
+bool CachedTexture::load(const std::string& sourcePath, TextureFormat requestedFormat, JobSystem* jobs, bool* cacheStored)
+{
+    if (cacheStored) *cacheStored = false;
+    levels.clear();
+    fromCache = false;
+    format = requestedFormat;
+    cacheFile.close();
+    mipLevels.clear();
+    compressedLevels.clear();
+
+    struct stat info;
+    if (stat(sourcePath.c_str(), &info) != 0) {
+        std::cerr << "Error: Could not open PPM file: " << sourcePath << std::endl;
+        return false;
+    }
+    const uint64_t sourceSize = (uint64_t)info.st_size;
+    const int64_t sourceTime = (int64_t)info.st_mtime;
+    const std::string cachePath = sourcePath + ".texcache";
+
+    if (mapCache(cachePath, sourceSize, sourceTime, sourcePath)) {
+        fromCache = true;
+        if (cacheStored) *cacheStored = true;
+        return true;
+    }
+
+    base = loadPPM(sourcePath, jobs);
+    if (!base.isValid) return false;
+    buildMipChain(base, mipLevels, MipFilter::Kaiser, jobs);
+
+    std::vector<const PPMImage*> decoded(1, &base);
+    for (const PPMImage& level : mipLevels) decoded.push_back(&level);
+
+    if (format == TextureFormat::RGB8) {
+        for (const PPMImage* level : decoded) {
+            levels.push_back(TextureLevel{ level->width, level->height, level->data.data(), level->data.size() });
+        }
+    } else {
+        compressedLevels.resize(decoded.size());
+        for (size_t i = 0; i < decoded.size(); ++i) {
+            const PPMImage& level = *decoded[i];
+            compressImage(level.data.data(), level.width, level.height, format, compressedLevels[i], jobs);
+            levels.push_back(TextureLevel{ level.width, level.height, compressedLevels[i].data(), compressedLevels[i].size() });
+        }
+        // The blocks are all that is uploaded; drop the decoded texels
+        base = PPMImage();
+        mipLevels.clear();
+    }
+
+    uint64_t sourceHash = 0;
+    bool written = hashFile(sourcePath, sourceHash) && writeCache(cachePath, sourceSize, sourceTime, sourceHash);
+    if (!written) std::cerr << "Warning: Could not write texture cache " << cachePath << std::endl;
+    if (cacheStored) *cacheStored = written;
+    return true;
+}
+
+bool CachedTexture::mapCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime, const std::string& sourcePath)
+{
+    if (!cacheFile.open(cachePath)) return false;
+
+    TextureCacheHeader header;
+    if (cacheFile.size() < sizeof(header)) { cacheFile.close(); return false; }
+    std::memcpy(&header, cacheFile.data(), sizeof(header));
+    if (std::memcmp(header.magic, cacheMagic, 4) != 0 || header.version != formatVersion || header.levelCount == 0 ||
+        header.format != (uint32_t)format ||
+        cacheFile.size() < sizeof(header) + header.levelCount * sizeof(TextureCacheLevel)) {
+        cacheFile.close();
+        return false;
+    }
+
+    // Size and time identify an unchanged source without reading it; if they
+    // differ (e.g. the file was touched or copied) fall back to the content hash
+    if (header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+        uint64_t sourceHash = 0;
+        if (header.sourceSize != sourceSize || !hashFile(sourcePath, sourceHash) || sourceHash != header.sourceHash) {
+            cacheFile.close();
+            return false;
+        }
+
+        // Same content: record the new time so the next start skips the hash
+        std::FILE* file = std::fopen(cachePath.c_str(), "r+b");
+        if (file) {
+            if (std::fseek(file, (long)offsetof(TextureCacheHeader, sourceTime), SEEK_SET) == 0) {
+                std::fwrite(&sourceTime, sizeof(sourceTime), 1, file);
+            }
+            std::fclose(file);
+        }
+    }
+
+    const char* table = cacheFile.data() + sizeof(header);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        TextureCacheLevel entry;
+        std::memcpy(&entry, table + i * sizeof(entry), sizeof(entry));
+        if (entry.size != compressedLevelSize((int)entry.width, (int)entry.height, format) || entry.offset + entry.size > cacheFile.size()) {
+            levels.clear();
+            cacheFile.close();
+            return false;
+        }
+        levels.push_back(TextureLevel{ (int)entry.width, (int)entry.height,
+                                       reinterpret_cast<const unsigned char*>(cacheFile.data() + entry.offset), (size_t)entry.size });
+    }
+    return true;
+}
+
+bool CachedTexture::writeCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime, uint64_t sourceHash) const
+{
+    TextureCacheHeader header;
+    std::memcpy(header.magic, cacheMagic, 4);
+    header.version = formatVersion;
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    header.sourceHash = sourceHash;
+    header.levelCount = (uint32_t)levels.size();
+    header.format = (uint32_t)format;
+
+    std::vector<TextureCacheLevel> table(levels.size());
+    uint64_t offset = sizeof(header) + table.size() * sizeof(TextureCacheLevel);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        offset = (offset + 15) & ~uint64_t(15);
+        table[i].width = (uint32_t)levels[i].width;
+        table[i].height = (uint32_t)levels[i].height;
+        table[i].offset = offset;
+        table[i].size = levels[i].size;
+        offset += table[i].size;
+    }
+
+    std::vector<FileChunk> chunks;
+    chunks.push_back(FileChunk{ &header, sizeof(header) });
+    chunks.push_back(FileChunk{ table.data(), table.size() * sizeof(TextureCacheLevel) });
+    uint64_t position = sizeof(header) + table.size() * sizeof(TextureCacheLevel);
+    static const char padding[16] = {};
+    for (size_t i = 0; i < levels.size(); ++i) {
+        chunks.push_back(FileChunk{ padding, (size_t)(table[i].offset - position) });
+        chunks.push_back(FileChunk{ levels[i].pixels, (size_t)table[i].size });
+        position = table[i].offset + table[i].size;
+    }
+    return writeFileAtomically(cachePath, chunks);
+}
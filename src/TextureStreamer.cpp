@@ -0,0 +1,291 @@
+#include "TextureStreamer.h"
+#include "TextureCache.h"
+#include <cstring>
+
+namespace {
+
+// Every level starts on a 16-byte boundary in the staging ring
+const size_t stagingAlignment = 16;
+
+size_t alignStaging(size_t offset) {
+    return (offset + stagingAlignment - 1) & ~(stagingAlignment - 1);
+}
+
+} // namespace
+
+TextureStreamer::TextureStreamer()
+{
+    jobs = nullptr;
+    arrays = nullptr;
+    stagingBuffer = 0;
+    stagingCapacity = 0;
+    persistentData = nullptr;
+    stagingMapped = false;
+    stagingHead = 0;
+    firstLiveSerial = 0;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // GL objects must already be gone (shutdown()); only the jobs are waited on here
+    if (jobs) {
+        for (size_t i = 0; i < requests.size(); ++i) jobs->wait(requests[i]->job);
+    }
+}
+
+void TextureStreamer::init(JobSystem& jobSystem, TextureArrays& textureArrays, size_t stagingBytes)
+{
+    jobs = &jobSystem;
+    arrays = &textureArrays;
+    stagingCapacity = alignStaging(stagingBytes);
+
+    glGenBuffers(1, &stagingBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+    if (GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)stagingCapacity, nullptr, flags);
+        persistentData = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)stagingCapacity, flags);
+    } else {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)stagingCapacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::shutdown()
+{
+    for (size_t i = 0; i < requests.size(); ++i) {
+        StreamRequest& request = *requests[i];
+        if (jobs) jobs->wait(request.job);
+        if (request.state == StreamState::Copying && !persistentData) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        if (request.slot.array != 0) arrays->release(request.slot);
+    }
+    requests.clear();
+
+    for (size_t i = 0; i < regions.size(); ++i) {
+        if (regions[i].fence) glDeleteSync(regions[i].fence);
+    }
+    regions.clear();
+
+    if (stagingBuffer != 0) {
+        if (persistentData) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &stagingBuffer);
+    }
+    stagingBuffer = 0;
+    persistentData = nullptr;
+    stagingMapped = false;
+    stagingHead = 0;
+    jobs = nullptr;
+    arrays = nullptr;
+}
+
+TextureStreamer::Handle TextureStreamer::request(const std::string& path, TextureFormat format)
+{
+    std::unique_ptr<StreamRequest> request(new StreamRequest());
+    request->path = path;
+    request->format = format;
+    request->state = StreamState::Loading;
+    request->texture.reset(new CachedTexture());
+    request->stagingOffset = 0;
+    request->stagingSize = 0;
+    request->regionSerial = 0;
+    request->stagingData = nullptr;
+    request->slot.array = 0;
+    request->slot.layer = 0;
+
+    StreamRequest* loading = request.get();
+    JobSystem* jobSystem = jobs;
+    jobs->submit([loading, jobSystem] {
+        loading->texture->load(loading->path, loading->format, jobSystem);
+    }, &loading->job);
+
+    requests.push_back(std::move(request));
+    return requests.size() - 1;
+}
+
+void TextureStreamer::update()
+{
+    retireStaging();
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        StreamRequest& request = *requests[i];
+        switch (request.state) {
+        case StreamState::Loading:
+            if (!request.job.isDone()) break;
+            if (!request.texture->isValid()) {
+                std::cerr << "Failed to load " << request.path << std::endl;
+                request.texture.reset();
+                request.state = StreamState::Failed;
+                break;
+            }
+            request.state = StreamState::Loaded;
+            // Try to stage it this frame
+            // fall through
+        case StreamState::Loaded:
+            beginStaging(request);
+            break;
+        case StreamState::Copying:
+            if (request.job.isDone()) finishStaging(request);
+            break;
+        case StreamState::Uploading:
+            if (isRetired(request.regionSerial)) {
+                request.state = StreamState::Ready;
+                std::cout << request.path << " streamed in (" << textureFormatName(request.format) << "). Array " << request.slot.array
+                          << ", layer " << request.slot.layer << std::endl;
+            }
+            break;
+        case StreamState::Ready:
+        case StreamState::Failed:
+            break;
+        }
+    }
+}
+
+TextureSlot TextureStreamer::getTexture(Handle handle) const
+{
+    if (handle >= requests.size() || requests[handle]->state != StreamState::Ready) return TextureSlot{ 0, 0 };
+    return requests[handle]->slot;
+}
+
+bool TextureStreamer::isPending(Handle handle) const
+{
+    if (handle >= requests.size()) return false;
+    StreamState state = requests[handle]->state;
+    return state != StreamState::Ready && state != StreamState::Failed;
+}
+
+void TextureStreamer::beginStaging(StreamRequest& request)
+{
+    const std::vector<TextureLevel>& levels = request.texture->getLevels();
+    request.levelOffsets.resize(levels.size());
+    size_t size = 0;
+    for (size_t level = 0; level < levels.size(); ++level) {
+        size = alignStaging(size);
+        request.levelOffsets[level] = size;
+        size += levels[level].size;
+    }
+
+    // Too big for the ring: upload straight from memory rather than never
+    if (size > stagingCapacity) {
+        std::cerr << "Warning: " << request.path << " exceeds the texture staging buffer, uploading synchronously" << std::endl;
+        const TextureLevel& base = request.texture->getLevels()[0];
+        request.slot = arrays->allocate(base.width, base.height, (int)levels.size(), request.format);
+        uploadLevels(*request.texture, request.slot, nullptr);
+        request.texture.reset();
+        request.state = StreamState::Ready;
+        return;
+    }
+
+    // No room until earlier uploads retire (or, without persistent mapping,
+    // until the buffer is unmapped again); stay Loaded and retry next frame
+    size_t offset = 0;
+    if (!persistentData && stagingMapped) return;
+    if (!allocateStaging(size, offset)) return;
+
+    request.stagingOffset = offset;
+    request.stagingSize = size;
+    request.regionSerial = firstLiveSerial + regions.size() - 1;
+    if (persistentData) {
+        request.stagingData = persistentData + offset;
+    } else {
+        // The fences already keep the GPU off this range, so skip the driver's own sync
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+        request.stagingData = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, (GLintptr)offset, (GLsizeiptr)size,
+                                                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!request.stagingData) {
+            // Give the region back (it is the newest) and retry next frame
+            regions.pop_back();
+            stagingHead = offset;
+            return;
+        }
+        stagingMapped = true;
+    }
+
+    StreamRequest* copying = &request;
+    jobs->submit([copying] {
+        const std::vector<TextureLevel>& levels = copying->texture->getLevels();
+        for (size_t level = 0; level < levels.size(); ++level) {
+            std::memcpy(copying->stagingData + copying->levelOffsets[level], levels[level].pixels, levels[level].size);
+        }
+    }, &request.job);
+    request.state = StreamState::Copying;
+}
+
+void TextureStreamer::finishStaging(StreamRequest& request)
+{
+    // Allocate first: a new array's storage must not be sourced from the staging buffer
+    const std::vector<TextureLevel>& levels = request.texture->getLevels();
+    request.slot = arrays->allocate(levels[0].width, levels[0].height, (int)levels.size(), request.format);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+    if (!persistentData) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        stagingMapped = false;
+    }
+
+    std::vector<size_t> offsets(request.levelOffsets);
+    for (size_t level = 0; level < offsets.size(); ++level) offsets[level] += request.stagingOffset;
+    uploadLevels(*request.texture, request.slot, &offsets);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // Everything that reads the staging range has been issued; fence it
+    regions[(size_t)(request.regionSerial - firstLiveSerial)].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    request.stagingData = nullptr;
+    request.texture.reset(); // The texels now live in the staging buffer
+    request.state = StreamState::Uploading;
+}
+
+// offsets: per-level byte offsets into the bound unpack buffer, or null to read client memory
+void TextureStreamer::uploadLevels(const CachedTexture& texture, const TextureSlot& slot, const std::vector<size_t>* offsets)
+{
+    const std::vector<TextureLevel>& levels = texture.getLevels();
+    for (size_t level = 0; level < levels.size(); ++level) {
+        const TextureLevel& l = levels[level];
+        const void* pixels = offsets ? (const void*)(uintptr_t)(*offsets)[level] : (const void*)l.pixels;
+        arrays->upload(slot, (int)level, l.width, l.height, pixels, l.size);
+    }
+}
+
+bool TextureStreamer::allocateStaging(size_t size, size_t& offset)
+{
+    if (regions.empty()) {
+        stagingHead = 0;
+    } else {
+        // The live regions span [tail, head), possibly wrapping; head never
+        // catches up with tail so a non-empty ring is never mistaken for empty
+        size_t tail = regions.front().offset;
+        if (stagingHead < tail) {
+            if (alignStaging(stagingHead + size) >= tail) return false;
+        } else if (stagingHead + size > stagingCapacity) {
+            if (alignStaging(size) >= tail) return false;
+            stagingHead = 0;
+        }
+    }
+
+    offset = stagingHead;
+    stagingHead = alignStaging(stagingHead + size);
+    regions.push_back(StagingRegion{ offset, size, nullptr });
+    return true;
+}
+
+void TextureStreamer::retireStaging()
+{
+    // Regions retire in order; one still being filled (no fence yet) holds back the rest
+    while (!regions.empty() && regions.front().fence) {
+        GLenum status = glClientWaitSync(regions.front().fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(regions.front().fence);
+        regions.pop_front();
+        ++firstLiveSerial;
+    }
+}
@@ -0,0 +1,24 @@
+#include "UniformBlocks.h"
+
+namespace {
+
+void bindBlock(GLuint program, const char* name, GLuint binding) {
+    GLuint index = glGetUniformBlockIndex(program, name);
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(program, index, binding);
+}
+
+} // namespace
+
+void bindUniformBlocks(GLuint program)
+{
+    bindBlock(program, "Camera", CameraBlockBinding);
+    bindBlock(program, "Lighting", LightBlockBinding);
+    bindBlock(program, "Materials", MaterialBlockBinding);
+}
+
+void storeMatrix(GLfloat* destination, const mat4& m)
+{
+    for (int row = 0; row < 4; ++row) {
+        for (int column = 0; column < 4; ++column) destination[row * 4 + column] = m[row][column];
+    }
+}
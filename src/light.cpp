@@ -18,13 +18,21 @@ Light::Light(GLfloat red, GLfloat green, GLfloat blue, GLfloat aIntensity,
     diffuseIntensity = dIntensity;
 }
 
-void Light::UseLight(GLfloat ambientIntensityLocation, GLfloat ambientColorLocation,
-                     GLfloat diffuseIntensityLocation, GLfloat directionLocation)
+void Light::SetDirection(const vec3& newDirection)
 {
-    glUniform3f(ambientColorLocation, color.x, color.y, color.z);
-    glUniform1f(ambientIntensityLocation, ambientIntensity);
-    glUniform3f(directionLocation, direction.x, direction.y, direction.z);
-    glUniform1f(diffuseIntensityLocation, diffuseIntensity);
+    direction = newDirection;
+}
+
+void Light::WriteBlock(LightBlock& block) const
+{
+    block.color[0] = color.x;
+    block.color[1] = color.y;
+    block.color[2] = color.z;
+    block.ambientIntensity = ambientIntensity;
+    block.direction[0] = direction.x;
+    block.direction[1] = direction.y;
+    block.direction[2] = direction.z;
+    block.diffuseIntensity = diffuseIntensity;
 }
 
 Light::~Light() {}
@@ -2,12 +2,22 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "Angel.h"
-#include "PhysicsObject.h"
+#include "PhysicsWorld.h"
 #include <vector>
 #include <fstream>
+#include <cstring>
 #include "light.h"
 #include "Material.h"
 #include "ppm_loader.h" // For loading PPM images
+#include "TextureStreamer.h"
+#include "JobSystem.h"
+#include "SimulationThread.h"
+#include "SphereInstances.h"
+#include "FrameRingBuffer.h"
+#include "UniformBlocks.h"
+#include "GLStateCache.h"
+#include "ShaderVariants.h"
+#include "SphereMesh.h"
 #include <cmath>
 
 #ifndef M_PI
@@ -18,6 +28,13 @@
 inline float degreesToRadians(float degrees) {
     return degrees * (float(M_PI) / 180.0f);
 }
+// Interpolates an angle in degrees across the 360 -> 0 wrap
+inline float interpolateAngle(float from, float to, float alpha) {
+    float delta = to - from;
+    if (delta > 180.0f) delta -= 360.0f;
+    else if (delta < -180.0f) delta += 360.0f;
+    return from + delta * alpha;
+}
 mat3 extract_mat3_from_mat4(const mat4& m) {
     return mat3(
         vec3(m[0].x, m[0].y, m[0].z),
@@ -26,41 +43,36 @@ mat3 extract_mat3_from_mat4(const mat4& m) {
     );
 }
 
-GLuint program;
+ShaderVariants shaderVariants; // vshader/fshader specialized per shading mode, texture path and shadow pass
 
-// Texture IDs
-GLuint earthTextureID = 0;
-GLuint basketballTextureID = 0;
+// Textures; the 2D ones stream into layers of textureArrays and read as array 0 until they arrive
+TextureArrays textureArrays;
+TextureStreamer::Handle earthTexture = 0;
+TextureStreamer::Handle basketballTexture = 0;
+std::vector<TextureStreamer::Handle> sphereTextures; // 2D texture of each body in physicsWorld
+std::vector<TextureSlot> sphereTextureSlots;          // Resolved each frame from sphereTextures
 GLuint synthetic1DTexID = 0;
-
-// For sphere texture coordinates
-std::vector<vec2> texCoords_sphere;
+TextureFormat gTextureFormat = TextureFormat::RGB8; // Best block format the driver supports, chosen in init()
 
 // For 1D Texture Mapping Bonus
 int g_activeTextureConfig = 0; // 0: Earth (2D), 1: Basketball (2D), 2: Synthetic (1D)
 vec4 g_1DTexturePlaneParams = vec4(0.0f, 1.0f, 0.0f, 0.0f); // Plane: y=0
 float g_1DTextureStripeFrequency = 10.0f;
 
-// Uniform locations
-GLuint u_ModelMatrixLoc = GL_INVALID_INDEX;
-GLuint u_1DTexturePlaneLoc = GL_INVALID_INDEX;
-GLuint u_1DTextureStripeScaleLoc = GL_INVALID_INDEX;
-GLuint u_currentTextureTypeLoc = GL_INVALID_INDEX;
-GLuint textureSampler2DLoc = GL_INVALID_INDEX;
-GLuint textureSampler1DLoc = GL_INVALID_INDEX;
-
-double frameRate = 120;
-double deltaTime = 1.0 / frameRate;
+double frameRate = 120; // Physics steps per second, independent of the display refresh rate
+double physicsTimeStep = 1.0 / frameRate;
 vec3 initialVelocity;
 typedef vec4  point4;
 
 int sceneWidth = 1200;
 int sceneHeight = 600;
 
-PhysicsObject bouncingObject;
+JobSystem jobSystem; // Worker pool for physics, mesh generation and texture decoding
+TextureStreamer textureStreamer; // Declared after jobSystem so its loads are waited on first
+PhysicsWorld physicsWorld;
+size_t bouncingObject = 0; // Index of the user-controlled sphere in physicsWorld
+SimulationThread simulationThread; // Steps physicsWorld; declared after it so it stops first
 vec3 computeInitialPosition(float objectSize);
-std::vector<vec3> normals_sphere;
-std::vector<vec4> colors_sphere;
 
 enum DisplayMode {
     MODE_SHADING = 0,
@@ -69,19 +81,22 @@ enum DisplayMode {
     MODE_TEXTURE = 3
 };
 DisplayMode currentDisplayMode = MODE_SHADING;
-GLuint displayModeLoc;
 
 const float floorLevel = -1.0f;
-GLuint u_isShadowPassLoc;
-GLuint u_shadowColorLoc;
 
-const int latitudeBands = 50;
-const int longitudeBands = 50;
-std::vector<point4> points_sphere;
-std::vector<GLuint> indices_sphere;
-GLuint sphereVAO, sphereVBO, sphereIBO;
+// Detail of each mesh LOD by topology, finest first: bands, subdivisions and
+// face divisions. Levels in the same position have similar errors.
+// tools/mesh_cache_report.cpp reports on the same levels.
+const std::vector<int> sphereLodDetail[3] = { { 50, 32, 20, 12, 8 }, { 4, 3, 2, 1 }, { 20, 12, 8, 4, 2 } };
+const char* const sphereTopologyNames[3] = { "UV sphere", "Icosphere", "Cube sphere" };
+SphereTopology gSphereTopology = SphereTopology::UVSphere;
+SphereMesh sphereMesh;               // Unit sphere LOD chain, one interleaved packed vertex buffer; instances scale it to their body radius
+const float sphereMeshRadius = 0.5f; // Radius the initial position of the first body is computed for
+SphereInstances sphereInstances;     // Per-body model matrix, material and texture layer
+FrameRingBuffer frameRing;           // Per-frame GPU data (sphere instances, Camera and Lighting blocks), written in place
+GLint gUniformBufferAlignment = 256; // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, queried in init()
+GLStateCache glState;                // display() sets state and uniforms through this, so unchanged ones cost nothing
 
-GLuint  ModelView, Projection;
 vec3 gCameraEye = vec3(0.0f, 0.5f, 3.0f);
 vec3 gCameraAt = vec3(0.0f, 0.0f, 0.0f);
 vec3 gCameraUp = vec3(0.0f, 1.0f, 0.0f);
@@ -95,19 +110,17 @@ const float gZoomStepFactor = 0.1f;
 
 Material plasticMaterial(0.5f, 32.0f);
 Material metallicMaterial(0.8f, 128.0f);
-Material currentMaterial;
+std::vector<Material> materialTable; // Uploaded to materialUBO (the Materials block) once in init()
+std::vector<int> sphereMaterials;     // Index into materialTable for each body in physicsWorld
+GLuint materialUBO = 0;
 
 int gShadingMode = 1; // 1 for Phong (default), 0 for Gouraud
-GLuint shadingModeLoc;
 
 bool gIsLightFixed = true;
 vec3 gFixedLightDirection_World = normalize(vec3(-0.5f, -0.5f, 1.0f));
 vec3 gObjectLocalLightDirection = normalize(vec3(0.0f, 0.0f, 1.0f));
-GLuint gLightDirectionLoc;
+Light mainLight(1.0f, 1.0f, 1.0f, 0.3f, 0.0f, 1.0f, 0.0f, 0.7f); // Direction is set in view space every frame
 
-GLuint materialSpecularIntensityLoc;
-GLuint materialShininessLoc;
-GLuint enableAmbientLoc, enableDiffuseLoc, enableSpecularLoc;
 float enableAmbientVal = 1.0f;
 float enableDiffuseVal = 1.0f;
 float enableSpecularVal = 1.0f;
@@ -124,200 +137,78 @@ void updateProjection() {
     GLfloat current_fovy = gInitialFOVy * gZoomFactor;
     if (current_fovy < 1.0f) current_fovy = 1.0f;
     if (current_fovy > 120.0f) current_fovy = 120.0f;
-    gProjectionMatrix = Perspective(current_fovy, aspect, gZNear, gZFar);
-    if (program && Projection != GL_INVALID_INDEX) {
-        glUseProgram(program);
-        glUniformMatrix4fv(Projection, 1, GL_TRUE, gProjectionMatrix);
-    }
+    gProjectionMatrix = Perspective(current_fovy, aspect, gZNear, gZFar); // Reaches the shaders through the Camera block
 }
 
-void generateSphere(float radius) {
-    points_sphere.clear();
-    indices_sphere.clear();
-    normals_sphere.clear();
-    colors_sphere.clear();
-    texCoords_sphere.clear();
-
-    for (int lat = 0; lat <= latitudeBands; ++lat) {
-        float theta = lat * float(M_PI) / latitudeBands;
-        float sinTheta = sin(theta);
-        float cosTheta = cos(theta);
-        for (int lon = 0; lon <= longitudeBands; ++lon) {
-            float phi = lon * 2.0f * float(M_PI) / longitudeBands;
-            float sinPhi = sin(phi);
-            float cosPhi = cos(phi);
-            float x = cosPhi * sinTheta;
-            float y = cosTheta;
-            float z = sinPhi * sinTheta;
-            points_sphere.push_back(point4(radius * x, radius * y, radius * z, 1.0));
-            normals_sphere.push_back(normalize(vec3(x, y, z)));
-            colors_sphere.push_back(vec4(1.0f, 0.0f, 0.0f, 1.0f)); // Default color red
-            float s = (float)lon / longitudeBands;
-            float t = 1.0f - (float)lat / latitudeBands;
-            texCoords_sphere.push_back(vec2(s, t));
-        }
-    }
-    for (int lat = 0; lat < latitudeBands; ++lat) {
-        for (int lon = 0; lon < longitudeBands; ++lon) {
-            int first = lat * (longitudeBands + 1) + lon;
-            int second = first + longitudeBands + 1;
-            indices_sphere.push_back(first);
-            indices_sphere.push_back(second);
-            indices_sphere.push_back(first + 1);
-            indices_sphere.push_back(second);
-            indices_sphere.push_back(second + 1);
-            indices_sphere.push_back(first + 1);
-        }
-    }
-}
-
-void setupSphereBuffers(GLuint vPositionLoc, GLuint vColorLoc, GLuint vNormalLoc, GLuint vTexCoordLoc) {
-    glGenVertexArrays(1, &sphereVAO);
-    glBindVertexArray(sphereVAO);
-
-    glGenBuffers(1, &sphereVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
-    glBufferData(GL_ARRAY_BUFFER, points_sphere.size() * sizeof(point4), points_sphere.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(vPositionLoc, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    glEnableVertexAttribArray(vPositionLoc);
-
-    GLuint sphereColorVBO; // This can be a local variable if not used elsewhere
-    glGenBuffers(1, &sphereColorVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphereColorVBO);
-    glBufferData(GL_ARRAY_BUFFER, colors_sphere.size() * sizeof(vec4), colors_sphere.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(vColorLoc, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    glEnableVertexAttribArray(vColorLoc);
-
-    GLuint sphereNormalVBO; // This can be a local variable
-    glGenBuffers(1, &sphereNormalVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphereNormalVBO);
-    glBufferData(GL_ARRAY_BUFFER, normals_sphere.size() * sizeof(vec3), normals_sphere.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(vNormalLoc, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    glEnableVertexAttribArray(vNormalLoc);
-
-    if (vTexCoordLoc != GL_INVALID_INDEX && !texCoords_sphere.empty()) {
-        GLuint sphereTexCoordVBO; // This can be a local variable
-        glGenBuffers(1, &sphereTexCoordVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, sphereTexCoordVBO);
-        glBufferData(GL_ARRAY_BUFFER, texCoords_sphere.size() * sizeof(vec2), texCoords_sphere.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(vTexCoordLoc, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-        glEnableVertexAttribArray(vTexCoordLoc);
-    } else if (vTexCoordLoc != GL_INVALID_INDEX) {
-         std::cerr << "Warning: vTexCoordLoc is valid for shader, but texCoords_sphere is empty." << std::endl;
-    }
-
-    glGenBuffers(1, &sphereIBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIBO); // This IBO binding becomes part of sphereVAO's state
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_sphere.size() * sizeof(GLuint), indices_sphere.data(), GL_STATIC_DRAW);
-
-    glBindVertexArray(0); // Unbind VAO first
-    glBindBuffer(GL_ARRAY_BUFFER, 0); // Then unbind VBO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // Unbind IBO (though VAO 0 doesn't record IBO state in the same way)
+// (Re)builds the sphere mesh for gSphereTopology. The instance attributes are
+// part of its VAO, so they are set up again too.
+void buildSphereMesh() {
+    sphereMesh.destroy();
+    sphereMesh.generate(gSphereTopology, sphereLodDetail[(int)gSphereTopology], &jobSystem);
+    sphereMesh.upload();
+    std::cout << "Sphere mesh: " << sphereTopologyNames[(int)gSphereTopology] << ", " << sphereMesh.getLods().size()
+              << " levels, " << sphereMesh.getVertexCount() << " vertices of " << sizeof(SphereVertex) << " bytes, "
+              << sphereMesh.getLods()[0].indexCount / 3 << " triangles at full detail"
+              << (sphereMesh.usesTables() ? " (compile-time tables)" : "") << std::endl;
+    sphereInstances.init(sphereMesh.getVAO(), 4); // iModelMatrix and iMaterialLayer, locations 4-8
+    std::vector<float> lodErrors;
+    for (const SphereLod& lod : sphereMesh.getLods()) lodErrors.push_back(lod.relativeError);
+    sphereInstances.setLodErrors(lodErrors);
+    glState.invalidate(); // A new VAO may reuse the old one's name
 }
 
 void init()
 {
     std::cout << "3.1 OpenGL Initialized!" << std::endl;
 
-    float sphereGeneratedRadius = 0.5f;
-    vec3 initPos = computeInitialPosition(sphereGeneratedRadius);
-    currentMaterial = plasticMaterial;
-    initialVelocity = vec3(0.5f, 0.0f, 0.0f);
-    bouncingObject = PhysicsObject(initPos, initialVelocity, vec3(0.0f), 1.0f);
-
-    program = InitShader("vshader.glsl", "fshader.glsl");
-    if (program == 0) {
-        std::cerr << "Failed to initialize shaders. Exiting." << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    glUseProgram(program);
-
-    // Get standard uniform locations
-    materialSpecularIntensityLoc = glGetUniformLocation(program, "material.specularIntensity");
-    materialShininessLoc = glGetUniformLocation(program, "material.shininess");
-    ModelView = glGetUniformLocation(program, "ModelView");
-    Projection = glGetUniformLocation(program, "Projection");
-    shadingModeLoc = glGetUniformLocation(program, "shadingMode");
-    displayModeLoc = glGetUniformLocation(program, "displayMode");
-    GLint eyePosLoc = glGetUniformLocation(program, "eyePosition");
-    gLightDirectionLoc = glGetUniformLocation(program, "directionalLight.direction");
-    enableAmbientLoc = glGetUniformLocation(program, "enableAmbient");
-    enableDiffuseLoc = glGetUniformLocation(program, "enableDiffuse");
-    enableSpecularLoc = glGetUniformLocation(program, "enableSpecular");
-    u_isShadowPassLoc = glGetUniformLocation(program, "u_isShadowPass");
-    u_shadowColorLoc = glGetUniformLocation(program, "u_shadowColor");
-
-    // Get attribute locations
-    GLuint vPositionLoc = glGetAttribLocation(program, "vPosition");
-    GLuint vColorLoc = glGetAttribLocation(program, "vColor");
-    GLuint vNormalLoc = glGetAttribLocation(program, "vNormal");
-    GLuint vTexCoordLoc = glGetAttribLocation(program, "aTexCoord");
-    if(vTexCoordLoc == GL_INVALID_INDEX) { // Should be found by shader
-        std::cerr << "Warning: Attribute 'aTexCoord' not found in vertex shader." << std::endl;
-    }
+    // BC7 keeps the most detail, BC1 is half its size; both beat uncompressed RGB8 on VRAM and bandwidth
+    if (GLEW_ARB_texture_compression_bptc) gTextureFormat = TextureFormat::BC7;
+    else if (GLEW_EXT_texture_compression_s3tc) gTextureFormat = TextureFormat::BC1;
 
-    generateSphere(sphereGeneratedRadius);
-    setupSphereBuffers(vPositionLoc, vColorLoc, vNormalLoc, vTexCoordLoc);
-
-    updateProjection();
-
-    // Set initial lighting uniforms
-    if (eyePosLoc != -1) glUniform3fv(eyePosLoc, 1, gCameraEye);
-    else std::cerr << "Warning: 'eyePosition' uniform not found." << std::endl;
-
-    vec3 lightColorVal(1.0f, 1.0f, 1.0f);
-    float ambientStrengthVal = 0.3f;
-    float diffuseIntensityVal = 0.7f;
-    GLint ambientColorLoc = glGetUniformLocation(program, "directionalLight.color");
-    GLint ambientIntensityLoc = glGetUniformLocation(program, "directionalLight.ambientIntensity");
-    GLint diffuseIntensityLoc = glGetUniformLocation(program, "directionalLight.diffuseIntensity");
-
-    if(ambientColorLoc != -1) glUniform3fv(ambientColorLoc, 1, &lightColorVal[0]);
-    if(ambientIntensityLoc != -1) glUniform1f(ambientIntensityLoc, ambientStrengthVal);
-    if(diffuseIntensityLoc != -1) glUniform1f(diffuseIntensityLoc, diffuseIntensityVal);
-    // gLightDirectionLoc is set per frame in display() as it might change
-
-    if(enableAmbientLoc != -1) glUniform1f(enableAmbientLoc, enableAmbientVal);
-    if(enableDiffuseLoc != -1) glUniform1f(enableDiffuseLoc, enableDiffuseVal);
-    if(enableSpecularLoc != -1) glUniform1f(enableSpecularLoc, enableSpecularVal);
-    if(shadingModeLoc != -1) glUniform1i(shadingModeLoc, gShadingMode);
-
-    // --- Texture Loading ---
+    // Both textures are loaded (cache mapped, or decoded, compressed and cached) on the
+    // worker pool and uploaded through the staging buffer by the render loop, so
+    // neither init() nor any later frame waits for them
+    std::cout << "Streaming 2D textures as " << textureFormatName(gTextureFormat) << "..." << std::endl;
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Important for tightly packed PPM data
+    textureStreamer.init(jobSystem, textureArrays);
+    earthTexture = textureStreamer.request("earth.ppm", gTextureFormat);
+    basketballTexture = textureStreamer.request("basketball.ppm", gTextureFormat);
+
+    vec3 initPos = computeInitialPosition(sphereMeshRadius);
+    materialTable.clear();
+    materialTable.push_back(plasticMaterial);
+    materialTable.push_back(metallicMaterial);
+    initialVelocity = vec3(0.5f, 0.0f, 0.0f);
+    physicsWorld.clear();
+    bouncingObject = physicsWorld.addBody(initPos, initialVelocity, 1.0f);
+    sphereTextures.assign(physicsWorld.size(), earthTexture);
+    sphereMaterials.assign(physicsWorld.size(), 0);
+
+    // Other variants are compiled the first time a mode needs them; the
+    // default one is built now so the first frame does not wait for it
+    shaderVariants.init("vshader.glsl", "fshader.glsl");
+    shaderVariants.get(ShaderVariantKey{ gShadingMode, ShaderTexture::None, false });
+
+    // Attribute locations are fixed by layout qualifiers in vshader.glsl, so
+    // the VAO works with every variant (some of which drop attributes)
+    buildSphereMesh();
+    frameRing.init();
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &gUniformBufferAlignment);
 
-    std::cout << "Loading 2D textures..." << std::endl;
-    PPMImage earthTexData = loadPPM("earth.ppm");
-    if (earthTexData.isValid) {
-        glGenTextures(1, &earthTextureID);
-        glBindTexture(GL_TEXTURE_2D, earthTextureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, earthTexData.width, earthTexData.height, 0, GL_RGB, GL_UNSIGNED_BYTE, earthTexData.data.data());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Using GL_LINEAR (no mipmap)
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // glGenerateMipmap(GL_TEXTURE_2D); // No mipmaps for this simplified setup
-        std::cout << "Earth texture loaded. ID: " << earthTextureID << std::endl;
-        glBindTexture(GL_TEXTURE_2D, 0);
-    } else {
-        std::cerr << "Failed to load earth.ppm" << std::endl;
-    }
+    updateProjection();
 
-    PPMImage basketballTexData = loadPPM("basketball.ppm");
-    if (basketballTexData.isValid) {
-        glGenTextures(1, &basketballTextureID);
-        glBindTexture(GL_TEXTURE_2D, basketballTextureID);
-        // *** CRITICAL FIX: Use basketballTexData here ***
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, basketballTexData.width, basketballTexData.height, 0, GL_RGB, GL_UNSIGNED_BYTE, basketballTexData.data.data());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Using GL_LINEAR
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // glGenerateMipmap(GL_TEXTURE_2D); // No mipmaps
-        std::cout << "Basketball texture loaded. ID: " << basketballTextureID << std::endl;
-        glBindTexture(GL_TEXTURE_2D, 0);
-    } else {
-        std::cerr << "Failed to load basketball.ppm" << std::endl;
+    // Spheres pick their material from this table by index. It never changes,
+    // so the Materials block lives in its own buffer; Camera and Lighting are
+    // written to the frame ring every frame
+    MaterialBlock materialBlock = MaterialBlock();
+    for (size_t i = 0; i < materialTable.size() && i < (size_t)MaxMaterials; ++i) {
+        materialTable[i].WriteBlock(materialBlock.materials[i]);
     }
+    glGenBuffers(1, &materialUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, materialUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialBlock), &materialBlock, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MaterialBlockBinding, materialUBO);
 
     std::cout << "Creating 1D synthetic texture..." << std::endl;
     const int tex1DWidth = 256;
@@ -340,21 +231,6 @@ void init()
         glBindTexture(GL_TEXTURE_1D, 0);
         std::cout << "1D Synthetic Texture loaded. ID: " << synthetic1DTexID << std::endl;
     }
-    // Get uniform locations for 1D/2D texturing
-    u_ModelMatrixLoc = glGetUniformLocation(program, "u_ModelMatrix");
-    u_1DTexturePlaneLoc = glGetUniformLocation(program, "u_1DTexturePlane");
-    u_1DTextureStripeScaleLoc = glGetUniformLocation(program, "u_1DTextureStripeScale");
-    u_currentTextureTypeLoc = glGetUniformLocation(program, "u_currentTextureType");
-    textureSampler2DLoc = glGetUniformLocation(program, "textureSampler2D");
-    textureSampler1DLoc = glGetUniformLocation(program, "textureSampler1D");
-
-    // Warnings for new uniforms (can be kept or removed)
-    if (u_ModelMatrixLoc == -1) std::cerr << "Warning: Uniform 'u_ModelMatrix' not found." << std::endl;
-    if (u_1DTexturePlaneLoc == -1) std::cerr << "Warning: Uniform 'u_1DTexturePlane' not found." << std::endl;
-    if (u_1DTextureStripeScaleLoc == -1) std::cerr << "Warning: Uniform 'u_1DTextureStripeScale' not found." << std::endl;
-    if (u_currentTextureTypeLoc == -1) std::cerr << "Warning: Uniform 'u_currentTextureType' not found." << std::endl;
-    if (textureSampler2DLoc == -1) std::cerr << "Warning: Uniform 'textureSampler2D' not found." << std::endl;
-    if (textureSampler1DLoc == -1) std::cerr << "Warning: Uniform 'textureSampler1D' not found." << std::endl;
 
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
@@ -364,70 +240,85 @@ void init()
     std::cout << "init() function completed." << std::endl;
 }
 
-void display(void) {
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// Draws every sphere instance, one instanced draw per LOD and texture array batch
+void drawSphereBatches(bool bindTextures) {
+    glState.bindVertexArray(sphereMesh.getVAO()); // VAO remembers the EBO binding
+    const std::vector<SphereLod>& lods = sphereMesh.getLods();
+    for (const SphereBatch& batch : sphereInstances.getBatches()) {
+        if (batch.count == 0) continue;
+        if (bindTextures) glState.bindTexture(0, GL_TEXTURE_2D_ARRAY, batch.textureArray);
+        sphereInstances.bindBatch(batch);
+        const SphereLod& lod = lods[batch.lod];
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.indexCount, sphereMesh.getIndexType(),
+                                          (void*)(lod.firstIndex * sphereMesh.getIndexSize()), (GLsizei)batch.count, lod.baseVertex);
+    }
+}
 
-    glUseProgram(program);
+// Copies a uniform block into this frame's ring segment and binds that range
+void streamUniformBlock(GLuint binding, const void* block, size_t size) {
+    size_t offset = 0;
+    void* destination = frameRing.allocate(size, (size_t)gUniformBufferAlignment, offset);
+    if (!destination) return; // beginFrame() reserves room, so this does not happen
+    memcpy(destination, block, size);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, frameRing.getBuffer(), (GLintptr)offset, (GLsizeiptr)size);
+}
+
+// alpha is the fraction of a physics step elapsed since the snapshot was taken
+void display(const SimulationSnapshot& snapshot, float alpha) {
+    glState.setCapability(GL_DEPTH_TEST, true);
+    glState.depthFunc(GL_LESS);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     if (currentDisplayMode == MODE_WIREFRAME) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        glState.polygonMode(GL_LINE);
     } else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glState.polygonMode(GL_FILL);
     }
 
-    int shaderDisplayModeForFS = 0;
-    if (currentDisplayMode == MODE_SHADING_WITH_SHADOW) shaderDisplayModeForFS = 0;
-    else if (currentDisplayMode == MODE_TEXTURE) shaderDisplayModeForFS = 2;
-    else if (currentDisplayMode == MODE_SHADING) shaderDisplayModeForFS = 0;
-    else if (currentDisplayMode == MODE_WIREFRAME) shaderDisplayModeForFS = 0;
-    if (displayModeLoc != -1) glUniform1i(displayModeLoc, shaderDisplayModeForFS);
-
-    if (materialSpecularIntensityLoc != -1 && materialShininessLoc != -1) {
-        currentMaterial.UseMaterial(materialSpecularIntensityLoc, materialShininessLoc);
-    }
+    // Bodies spawned since the last frame get alternating materials and textures
+    const size_t bodyCount = snapshot.positions.size();
+    while (sphereMaterials.size() < bodyCount) sphereMaterials.push_back((int)(sphereMaterials.size() % materialTable.size()));
+    while (sphereTextures.size() < bodyCount) sphereTextures.push_back(sphereTextures.size() % 2 == 0 ? earthTexture : basketballTexture);
 
-    bouncingObject.update(deltaTime);
+    // Room for this frame's instances plus the uniform blocks; the ring grows
+    // before anything is written if it has to
+    frameRing.beginFrame(bodyCount * sizeof(SphereInstance) + 4096);
 
     mat4 view_matrix = LookAt(gCameraEye, gCameraAt, gCameraUp);
-    mat4 sphere_model_matrix = Translate(bouncingObject.position.x, bouncingObject.position.y, bouncingObject.position.z) *
-                           RotateY(Theta[Yaxis]) * RotateZ(Theta[Zaxis]) * Scale(0.48f, 0.48f, 0.48f);
-
-    if (u_ModelMatrixLoc != -1) glUniformMatrix4fv(u_ModelMatrixLoc, 1, GL_TRUE, sphere_model_matrix);
-
-    int currentTexTypeShaderEnum = 0;
-    if (g_activeTextureConfig == 2 && synthetic1DTexID != 0) {
-        currentTexTypeShaderEnum = 1;
-    }
-    if (u_currentTextureTypeLoc != -1) glUniform1i(u_currentTextureTypeLoc, currentTexTypeShaderEnum);
-
-    // Always set sampler uniforms to their respective texture units
-    if (textureSampler2DLoc != -1) glUniform1i(textureSampler2DLoc, 0); // textureSampler2D uses unit 0
-    if (textureSampler1DLoc != -1) glUniform1i(textureSampler1DLoc, 1); // textureSampler1D uses unit 1
+    mat4 sphere_rotation = RotateY(Theta[Yaxis]) * RotateZ(Theta[Zaxis]);
 
+    // The display mode and texture choice pick the shader variant; it holds
+    // only the path drawn this frame instead of branching per fragment
+    ShaderVariantKey key = ShaderVariantKey{ gShadingMode, ShaderTexture::None, false };
     if (currentDisplayMode == MODE_TEXTURE) {
-        if (currentTexTypeShaderEnum == 1) { // 1D Texture
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_1D, synthetic1DTexID);
-            if (u_1DTexturePlaneLoc != -1) glUniform4fv(u_1DTexturePlaneLoc, 1, &g_1DTexturePlaneParams[0]);
-            if (u_1DTextureStripeScaleLoc != -1) glUniform1f(u_1DTextureStripeScaleLoc, g_1DTextureStripeFrequency);
+        key.texture = g_activeTextureConfig == 2 && synthetic1DTexID != 0 ? ShaderTexture::Texture1D : ShaderTexture::Texture2D;
+    }
+    const ShaderVariant& variant = shaderVariants.get(key);
+    glState.useProgram(variant.program);
+
+    bool textured2D = false;
+    if (key.texture != ShaderTexture::None) {
+        if (key.texture == ShaderTexture::Texture1D) {
+            glState.bindTexture(1, GL_TEXTURE_1D, synthetic1DTexID);
+            const vec4& plane = g_1DTexturePlaneParams;
+            glState.uniform4f(variant.texturePlane, plane.x, plane.y, plane.z, plane.w);
+            glState.uniform1f(variant.stripeScale, g_1DTextureStripeFrequency);
         } else { // 2D Texture
-            glActiveTexture(GL_TEXTURE0);
-            GLuint texToBind = 0;
-            if (g_activeTextureConfig == 0 && earthTextureID != 0) texToBind = earthTextureID;
-            else if (g_activeTextureConfig == 1 && basketballTextureID != 0) texToBind = basketballTextureID;
-            else if (earthTextureID != 0) texToBind = earthTextureID;
-            else if (basketballTextureID != 0) texToBind = basketballTextureID;
-            glBindTexture(GL_TEXTURE_2D, texToBind);
+            // Each sphere's texture is a layer of a shared array, bound per batch below;
+            // spheres whose texture has not streamed in yet borrow one that has
+            TextureSlot fallback = textureStreamer.getTexture(earthTexture);
+            if (fallback.array == 0) fallback = textureStreamer.getTexture(basketballTexture);
+            sphereTextureSlots.resize(bodyCount);
+            for (size_t i = 0; i < bodyCount; ++i) {
+                TextureSlot slot = textureStreamer.getTexture(sphereTextures[i]);
+                sphereTextureSlots[i] = slot.array != 0 ? slot : fallback;
+            }
+            textured2D = true;
         }
     } else {
         // When not in texture mode, unbind textures from our managed units
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_1D, 0);
-        glActiveTexture(GL_TEXTURE0); // Reset active unit
+        glState.bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+        glState.bindTexture(1, GL_TEXTURE_1D, 0);
     }
 
     vec3 world_light_direction_vector;
@@ -439,52 +330,64 @@ void display(void) {
         world_light_direction_vector = normalize(object_orientation_matrix_3x3 * gObjectLocalLightDirection);
     }
     vec3 currentLightDirection_ViewSpace = normalize(extract_mat3_from_mat4(view_matrix) * world_light_direction_vector);
-    if (gLightDirectionLoc != -1) glUniform3fv(gLightDirectionLoc, 1, &currentLightDirection_ViewSpace[0]);
-
-    if (u_isShadowPassLoc != -1) glUniform1i(u_isShadowPassLoc, 0);
-    mat4 final_model_view_matrix = view_matrix * sphere_model_matrix;
-    glUniformMatrix4fv(ModelView, 1, GL_TRUE, final_model_view_matrix);
-
-    glBindVertexArray(sphereVAO);
-    //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIBO); // VAO remembers the EBO binding
-
-    glDrawElements(GL_TRIANGLES, indices_sphere.size(), GL_UNSIGNED_INT, 0);
+    mainLight.SetDirection(currentLightDirection_ViewSpace);
+
+    // Camera and Lighting replace a dozen glUniform calls with one range bind each
+    CameraBlock camera;
+    storeMatrix(camera.view, view_matrix);
+    storeMatrix(camera.projection, gProjectionMatrix);
+    camera.eyePosition[0] = gCameraEye.x;
+    camera.eyePosition[1] = gCameraEye.y;
+    camera.eyePosition[2] = gCameraEye.z;
+    camera.padding = 0.0f;
+    streamUniformBlock(CameraBlockBinding, &camera, sizeof(camera));
+
+    LightBlock light;
+    mainLight.WriteBlock(light);
+    light.enableAmbient = enableAmbientVal;
+    light.enableDiffuse = enableDiffuseVal;
+    light.enableSpecular = enableSpecularVal;
+    light.padding = 0.0f;
+    streamUniformBlock(LightBlockBinding, &light, sizeof(light));
+
+    static const std::vector<TextureSlot> noTextures;
+    // Pixels per world unit at view depth 1; gProjectionMatrix already carries gZoomFactor
+    float pixelsPerUnit = gProjectionMatrix[1][1] * sceneHeight * 0.5f;
+    sphereInstances.build(snapshot, alpha, sphere_rotation, 1.0f, sphereMaterials,
+                          textured2D ? sphereTextureSlots : noTextures, view_matrix, pixelsPerUnit, frameRing, &jobSystem);
+    frameRing.flush();
+
+    glState.uniformMatrix4(variant.shadowMatrix, Angel::identity());
+    drawSphereBatches(textured2D);
     
-    if (currentDisplayMode == MODE_SHADING_WITH_SHADOW) {
-        if (u_isShadowPassLoc != -1) glUniform1i(u_isShadowPassLoc, 1);
-        if (u_shadowColorLoc != -1) glUniform4f(u_shadowColorLoc, 0.2f, 0.2f, 0.2f, 0.6f);
+    // A light parallel to the floor casts no shadow on it
+    vec3 L = normalize(world_light_direction_vector);
+    if (currentDisplayMode == MODE_SHADING_WITH_SHADOW && abs(L.y) > 0.0001f) {
+        const ShaderVariant& shadowVariant = shaderVariants.get(ShaderVariantKey{ gShadingMode, ShaderTexture::None, true });
+        glState.useProgram(shadowVariant.program);
+        glState.uniform4f(shadowVariant.shadowColor, 0.2f, 0.2f, 0.2f, 0.6f);
         
-        vec3 L = normalize(world_light_direction_vector);
         mat4 directionalShadowMatrix = Angel::identity(); // Check mat.h if this causes console messages
-        if (abs(L.y) > 0.0001f) {
-            directionalShadowMatrix[0][1] = -L.x / L.y;
-            directionalShadowMatrix[1][1] = 0.0f;
-            directionalShadowMatrix[2][1] = -L.z / L.y;
-            directionalShadowMatrix[0][3] = (L.x / L.y) * floorLevel;
-            directionalShadowMatrix[1][3] = floorLevel;
-            directionalShadowMatrix[2][3] = (L.z / L.y) * floorLevel;
-        } else {
-             if (u_isShadowPassLoc != -1) glUniform1i(u_isShadowPassLoc, 0);
-        }
+        directionalShadowMatrix[0][1] = -L.x / L.y;
+        directionalShadowMatrix[1][1] = 0.0f;
+        directionalShadowMatrix[2][1] = -L.z / L.y;
+        directionalShadowMatrix[0][3] = (L.x / L.y) * floorLevel;
+        directionalShadowMatrix[1][3] = floorLevel;
+        directionalShadowMatrix[2][3] = (L.z / L.y) * floorLevel;
+        glState.uniformMatrix4(shadowVariant.shadowMatrix, directionalShadowMatrix);
+
+        glState.setCapability(GL_BLEND, true);
+        glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glState.depthMask(GL_FALSE);
+
+        drawSphereBatches(false);
         
-        mat4 model_matrix_for_shadow = directionalShadowMatrix * sphere_model_matrix;
-        mat4 final_shadow_model_view = view_matrix * model_matrix_for_shadow;
-        glUniformMatrix4fv(ModelView, 1, GL_TRUE, final_shadow_model_view);
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDepthMask(GL_FALSE);
-
-        glDrawElements(GL_TRIANGLES, indices_sphere.size(), GL_UNSIGNED_INT, 0);
-        
-        glDepthMask(GL_TRUE);
-        glDisable(GL_BLEND);
-        if (u_isShadowPassLoc != -1) glUniform1i(u_isShadowPassLoc, 0);
+        glState.depthMask(GL_TRUE);
+        glState.setCapability(GL_BLEND, false);
     }
-    
-    if(enableAmbientLoc != -1) glUniform1f(enableAmbientLoc, enableAmbientVal);
-    if(enableDiffuseLoc != -1) glUniform1f(enableDiffuseLoc, enableDiffuseVal);
-    if(enableSpecularLoc != -1) glUniform1f(enableSpecularLoc, enableSpecularVal);
+
+    // Every draw reading this frame's ring segment has been issued
+    frameRing.endFrame();
 
     // glFinish(); // Generally not needed and can hurt performance
 }
@@ -499,6 +402,7 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     case GLFW_KEY_I:
     {
         g_activeTextureConfig = (g_activeTextureConfig + 1) % 3;
+        if (g_activeTextureConfig < 2) sphereTextures[bouncingObject] = g_activeTextureConfig == 0 ? earthTexture : basketballTexture;
         if (g_activeTextureConfig == 0) std::cout << "Switched to Earth Texture (2D)" << std::endl;
         else if (g_activeTextureConfig == 1) std::cout << "Switched to Basketball Texture (2D)" << std::endl;
         else if (g_activeTextureConfig == 2) std::cout << "Switched to Synthetic 1D Texture" << std::endl;
@@ -516,16 +420,49 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
                   << "Z -- Zoom In\n"
                   << "W -- Zoom Out\n"
                   << "R -- Reset the object position\n"
+                  << "C -- Spawn a crowd of 10000 small spheres\n"
+                  << "G -- Print how many GL calls the state cache skipped\n"
+                  << "P -- Cycle sphere mesh (UV sphere / Icosphere / Cube sphere)\n"
                   << "Q / ESC -- Quit\n" << std::endl;
         break;
     case GLFW_KEY_R:
     {
-        float sphereGeneratedRadius = 0.5f;
-        vec3 pos = computeInitialPosition(sphereGeneratedRadius);
-        bouncingObject.position = pos;
-        bouncingObject.velocity = initialVelocity;
-        bouncingObject.acceleration = vec3(0.0f, 0.0f, 0.0f);
-        std::cout << "Object position reset." << std::endl;
+        SimulationCommand reset;
+        reset.type = SimulationCommandType::ResetBody;
+        reset.body = bouncingObject;
+        reset.count = 0;
+        reset.radius = 0.0f;
+        reset.position = computeInitialPosition(sphereMeshRadius);
+        reset.velocity = initialVelocity;
+        if (simulationThread.sendCommand(reset)) std::cout << "Object position reset." << std::endl;
+        break;
+    }
+    case GLFW_KEY_G:
+    {
+        const GLStateCache::Stats& stats = glState.getStats();
+        size_t total = stats.issued + stats.elided;
+        std::cout << "GL state cache: " << stats.issued << " calls issued, " << stats.elided << " skipped as redundant";
+        if (total > 0) std::cout << " (" << (100 * stats.elided / total) << "%)";
+        std::cout << std::endl;
+        glState.resetStats();
+        break;
+    }
+    case GLFW_KEY_P:
+    {
+        gSphereTopology = (SphereTopology)(((int)gSphereTopology + 1) % 3);
+        buildSphereMesh();
+        break;
+    }
+    case GLFW_KEY_C:
+    {
+        SimulationCommand spawn;
+        spawn.type = SimulationCommandType::SpawnBodies;
+        spawn.body = 0;
+        spawn.count = 10000;
+        spawn.radius = 0.02f;
+        spawn.position = vec3(0.0f, 0.5f, -1.0f);
+        spawn.velocity = vec3(0.0f, 0.0f, 0.0f);
+        if (simulationThread.sendCommand(spawn)) std::cout << "Spawned " << spawn.count << " spheres." << std::endl;
         break;
     }
     case GLFW_KEY_O:
@@ -548,7 +485,6 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     {
         gShadingMode = 1 - gShadingMode;
         std::cout << "Switched to " << (gShadingMode == 0 ? "Gouraud" : "Phong") << " Shading" << std::endl;
-        if (shadingModeLoc != -1) { glUseProgram(program); glUniform1i(shadingModeLoc, gShadingMode);}
         break;
     }
     case GLFW_KEY_L:
@@ -559,10 +495,9 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     }
     case GLFW_KEY_M:
     {
-        static bool isPlastic = true;
-        if (isPlastic) { currentMaterial = metallicMaterial; std::cout << "Switched to Metallic Material" << std::endl;}
-        else { currentMaterial = plasticMaterial; std::cout << "Switched to Plastic Material" << std::endl;}
-        isPlastic = !isPlastic;
+        int& material = sphereMaterials[bouncingObject];
+        material = 1 - material;
+        std::cout << "Switched to " << (material == 0 ? "Plastic" : "Metallic") << " Material" << std::endl;
         break;
     }
     case GLFW_KEY_Z: { gZoomFactor *= (1.0f - gZoomStepFactor); if (gZoomFactor < 0.05f) gZoomFactor = 0.05f; updateProjection(); break; }
@@ -632,29 +567,33 @@ int main() {
 
     init();
 
-    double lastTime = glfwGetTime();
+    // Physics and the Theta[] rotation advance in fixed steps on their own
+    // thread; this loop only handles input and draws the latest snapshot
+    simulationThread.start(physicsWorld, &jobSystem, physicsTimeStep, Axis, rotationSpeed);
+
     while (!glfwWindowShouldClose(window)) {
-        double currentTime = glfwGetTime();
-        deltaTime = currentTime - lastTime;
-        if (deltaTime > 1.0/20.0) deltaTime = 1.0/20.0; // Cap deltaTime to avoid jumps
-        lastTime = currentTime;
         glfwPollEvents();
-        Theta[Axis] += rotationSpeed * (float)deltaTime;
-        if (Theta[Axis] > 360.0f) Theta[Axis] -= 360.0f;
-        else if (Theta[Axis] < 0.0f) Theta[Axis] += 360.0f;
-        display();
+        textureStreamer.update();
+        glState.invalidateTextures(); // Uploads bind textures directly
+        const SimulationSnapshot& snapshot = simulationThread.acquireSnapshot();
+        float alpha = simulationThread.interpolationAlpha(snapshot);
+        for (int i = 0; i < NumAxes; ++i) {
+            Theta[i] = interpolateAngle(snapshot.previousTheta[i], snapshot.theta[i], alpha);
+        }
+        display(snapshot, alpha);
         glfwSwapBuffers(window);
     }
+    simulationThread.stop();
 
     // Cleanup
-    if (earthTextureID != 0) glDeleteTextures(1, &earthTextureID);
-    if (basketballTextureID != 0) glDeleteTextures(1, &basketballTextureID);
+    textureStreamer.shutdown();
+    textureArrays.clear();
     if (synthetic1DTexID != 0) glDeleteTextures(1, &synthetic1DTexID);
     
-    glDeleteVertexArrays(1, &sphereVAO);
-    glDeleteBuffers(1, &sphereVBO);
-    glDeleteBuffers(1, &sphereIBO);
-    if(program != 0) glDeleteProgram(program);
+    frameRing.destroy();
+    glDeleteBuffers(1, &materialUBO);
+    sphereMesh.destroy();
+    shaderVariants.clear();
 
     std::cout << "OpenGL Process Done!" << std::endl;
     glfwDestroyWindow(window);
@@ -1,95 +1,301 @@
 #include "ppm_loader.h" // Include your new header file
+#include "MappedFile.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
 
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream> // Required for std::stringstream
 
-// Function definition for loading a P3 PPM file
-PPMImage loadPPM(const std::string& filename) {
-    PPMImage image; // Resulting image object
-    std::ifstream ifs(filename);
+#if defined(SPHERE_HAS_SSE)
+    #include <emmintrin.h>
+#endif
 
-    if (!ifs.is_open()) {
-        std::cerr << "Error: Could not open PPM file: " << filename << std::endl;
-        image.isValid = false;
-        return image;
+// Files are memory mapped and parsed in place. ASCII payloads (P3) are
+// scanned by hand instead of going through locale-aware stream extraction;
+// binary payloads (P5/P6) are copied, byte swapped (16-bit) and rescaled to
+// 8 bits with SSE2 where needed. PPMImage::data is always 8-bit RGB.
+namespace {
+
+// Bytes per chunk when a large ASCII payload is decoded in parallel
+const size_t parallelChunkBytes = 1 << 20;
+
+// Payloads go parallel only with at least this many chunks per worker; below
+// that the counting pass and job overhead cost more than the split saves
+// (basketball.ppm, at about 1.1 MB, is faster serial)
+const size_t parallelChunksPerWorker = 4;
+
+// Counting and then parsing reads the payload twice, about twice the work of
+// the serial scan, so one worker plus the caller cannot win (tools/ppm_bench)
+const unsigned parallelMinWorkers = 2;
+
+// Largest width or height accepted; well above any GL texture size limit
+const unsigned maxImageDimension = 1 << 16;
+
+inline bool isDigit(char c) {
+    return (unsigned)(c - '0') <= 9u;
+}
+
+// Skips whitespace, then parses an unsigned decimal; p is left after the number.
+// Numbers above INT_MAX fail instead of wrapping around.
+inline bool parseUnsigned(const char*& p, const char* end, unsigned& value) {
+    while (p < end && (unsigned char)*p <= ' ') ++p;
+    if (p == end || !isDigit(*p)) return false;
+    uint64_t v = 0;
+    do {
+        v = v * 10 + (unsigned)(*p - '0');
+        if (v > (uint64_t)INT_MAX) return false;
+        ++p;
+    } while (p < end && isDigit(*p));
+    value = (unsigned)v;
+    return true;
+}
+
+// Header fields may be separated by whitespace and '#' comments running to end of line
+inline bool parseHeaderValue(const char*& p, const char* end, unsigned& value) {
+    while (p < end) {
+        if (*p == '#') {
+            while (p < end && *p != '\n') ++p;
+        } else if ((unsigned char)*p <= ' ') {
+            ++p;
+        } else {
+            break;
+        }
     }
+    return parseUnsigned(p, end, value);
+}
 
-    std::string magicNumber;
-    ifs >> magicNumber; // Read the magic number ("P3")
+// Maps samples in [0, maxValue] to [0, 255] as round(v * 255 / maxValue).
+// Values above maxValue are clamped. The SSE2 path performs the same float
+// operations per lane as the scalar tail, so both give identical bytes.
+void rescaleSamples(const uint16_t* in, size_t count, unsigned maxValue, unsigned char* out) {
+    const float scale = 255.0f / (float)maxValue;
+    size_t i = 0;
+#if defined(SPHERE_HAS_SSE)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maxSample = _mm_set1_epi16((short)maxValue);
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 16 <= count; i += 16) {
+        __m128i packed[2];
+        for (int k = 0; k < 2; ++k) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + k * 8));
+            v = _mm_subs_epu16(v, _mm_subs_epu16(v, maxSample)); // min(v, maxValue)
+            __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+            __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+            __m128i loBytes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(lo, vscale), half));
+            __m128i hiBytes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(hi, vscale), half));
+            packed[k] = _mm_packs_epi32(loBytes, hiBytes);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(packed[0], packed[1]));
+    }
+#endif
+    for (; i < count; ++i) {
+        unsigned v = in[i] < maxValue ? in[i] : maxValue;
+        float scaled = (float)v * scale;
+        out[i] = static_cast<unsigned char>((int)(scaled + 0.5f));
+    }
+}
 
-    if (magicNumber != "P3") {
-        std::cerr << "Error: " << filename << " is not a valid P3 PPM file. Magic number was: " << magicNumber << std::endl;
-        image.isValid = false;
-        ifs.close();
-        return image;
+// Parses count ASCII samples into out, clamping them to maxValue. out is
+// either the final 8-bit data (maxValue 255) or 16-bit samples to rescale.
+template <typename Sample>
+bool parseAsciiSamples(const char*& p, const char* end, size_t count, unsigned maxValue, Sample* out) {
+    unsigned value;
+    for (size_t i = 0; i < count; ++i) {
+        if (!parseUnsigned(p, end, value)) return false;
+        out[i] = static_cast<Sample>(value < maxValue ? value : maxValue);
     }
-    // Optional: Informative message
-    // std::cout << filename << " identified as a P3 PPM file." << std::endl;
+    return true;
+}
 
-    // Consume the rest of the line after "P3" if any characters are there
-    std::string restOfMagicNumberLine;
-    std::getline(ifs, restOfMagicNumberLine);
+// Counts the numbers in [begin, end); any character that is neither a digit
+// nor whitespace makes the payload invalid
+size_t countAsciiTokens(const char* begin, const char* end, bool& valid) {
+    size_t count = 0;
+    bool inToken = false;
+    for (const char* c = begin; c < end; ++c) {
+        bool digit = isDigit(*c);
+        if (!digit && (unsigned char)*c > ' ') valid = false;
+        count += digit && !inToken;
+        inToken = digit;
+    }
+    return count;
+}
 
-    // Variables to store dimensions and max color value
-    int width = 0, height = 0, maxColorValue = 0;
-    int* valuesToRead[] = {&width, &height, &maxColorValue};
-    int valuesReadCount = 0;
-    std::string currentLine;
+// Parallel version of parseAsciiSamples. The payload is split into chunks at
+// whitespace so no number straddles two chunks; the numbers in every chunk
+// are counted in parallel, a prefix sum gives each chunk its first sample
+// index, and then all chunks are decoded concurrently into their slice.
+template <typename Sample>
+bool parseAsciiSamplesParallel(const char* p, const char* end, size_t count, unsigned maxValue, Sample* out, JobSystem& jobs) {
+    const size_t chunkCount = (size_t)(end - p) / parallelChunkBytes + 1;
+    std::vector<const char*> bounds(chunkCount + 1);
+    bounds[0] = p;
+    bounds[chunkCount] = end;
+    for (size_t c = 1; c < chunkCount; ++c) {
+        const char* b = p + (size_t)(end - p) * c / chunkCount;
+        if (b < bounds[c - 1]) b = bounds[c - 1];
+        while (b < end && (unsigned char)*b > ' ') ++b;
+        bounds[c] = b;
+    }
 
-    // Read width, height, and maxColorValue, skipping comments
-    while (valuesReadCount < 3 && std::getline(ifs, currentLine)) {
-        if (currentLine.empty() || currentLine[0] == '#') { // Skip empty lines and comments
-            // Optional: print comments
-            // if (currentLine[0] == '#') std::cout << "Comment: " << currentLine << std::endl;
-            continue;
+    std::vector<size_t> firstSample(chunkCount + 1, 0);
+    std::vector<char> chunkValid(chunkCount, 1);
+    jobs.parallelFor(0, chunkCount, 1, [&](size_t begin, size_t finish) {
+        for (size_t c = begin; c < finish; ++c) {
+            bool valid = true;
+            firstSample[c + 1] = countAsciiTokens(bounds[c], bounds[c + 1], valid);
+            chunkValid[c] = valid;
         }
+    });
+    for (size_t c = 0; c < chunkCount; ++c) {
+        firstSample[c + 1] += firstSample[c];
+    }
 
-        std::stringstream ss(currentLine);
-        int valueOnLine;
-        while (ss >> valueOnLine) { // Read all integer values on the current line
-            if (valuesReadCount < 3) {
-                *valuesToRead[valuesReadCount] = valueOnLine;
-                valuesReadCount++;
-            }
+    // The serial parser stops at the first bad character or missing sample;
+    // only the chunks up to the last needed sample have to be valid
+    for (size_t c = 0; c < chunkCount && firstSample[c] < count; ++c) {
+        if (!chunkValid[c]) return false;
+    }
+    if (firstSample[chunkCount] < count) return false;
+
+    // A chunk can still fail here on a number the counting pass accepted
+    // (one above INT_MAX), which fails the whole load like the serial parser
+    std::vector<char> chunkParsed(chunkCount, 1);
+    jobs.parallelFor(0, chunkCount, 1, [&](size_t begin, size_t finish) {
+        for (size_t c = begin; c < finish; ++c) {
+            if (firstSample[c] >= count) continue;
+            size_t samples = firstSample[c + 1] < count ? firstSample[c + 1] - firstSample[c] : count - firstSample[c];
+            const char* chunk = bounds[c];
+            chunkParsed[c] = parseAsciiSamples(chunk, bounds[c + 1], samples, maxValue, out + firstSample[c]);
         }
+    });
+    for (size_t c = 0; c < chunkCount; ++c) {
+        if (!chunkParsed[c]) return false;
     }
+    return true;
+}
 
-    if (valuesReadCount < 3 || width <= 0 || height <= 0 || maxColorValue <= 0) {
+// Binary 16-bit samples are stored most significant byte first
+void loadBigEndianSamples(const unsigned char* in, size_t count, uint16_t* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = (uint16_t)((in[2 * i] << 8) | in[2 * i + 1]);
+    }
+}
+
+// Widens one gray sample per pixel to RGB, in place from the back
+void expandGrayToRGB(std::vector<unsigned char>& data, size_t pixelCount) {
+    for (size_t i = pixelCount; i-- > 0;) {
+        unsigned char gray = data[i];
+        data[i * 3 + 0] = gray;
+        data[i * 3 + 1] = gray;
+        data[i * 3 + 2] = gray;
+    }
+}
+
+} // namespace
+
+// Function definition for loading a P3 (ASCII RGB), P6 (binary RGB) or
+// P5 (binary grayscale) file with 8 or 16 bits per sample
+PPMImage loadPPM(const std::string& filename, JobSystem* jobs) {
+    PPMImage image; // Resulting image object
+    MappedFile file;
+
+    if (!file.open(filename)) {
+        std::cerr << "Error: Could not open PPM file: " << filename << std::endl;
+        image.isValid = false;
+        return image;
+    }
+
+    const char* p = file.data();
+    const char* end = p + file.size();
+
+    // Read the magic number ("P3", "P5" or "P6")
+    char format = file.size() >= 2 && p[0] == 'P' ? p[1] : 0;
+    if ((format != '3' && format != '5' && format != '6') || (file.size() > 2 && (unsigned char)p[2] > ' ')) {
+        std::string magicNumber(p, p + (file.size() < 2 ? file.size() : 2));
+        std::cerr << "Error: " << filename << " is not a supported PPM/PGM file (P3, P5, P6). Magic number was: " << magicNumber << std::endl;
+        image.isValid = false;
+        return image;
+    }
+    p += 2;
+
+    // Read width, height, and maxColorValue, skipping comments
+    unsigned width = 0, height = 0, maxColorValue = 0;
+    if (!parseHeaderValue(p, end, width) || !parseHeaderValue(p, end, height) || !parseHeaderValue(p, end, maxColorValue) ||
+        width == 0 || height == 0 || width > maxImageDimension || height > maxImageDimension ||
+        maxColorValue == 0 || maxColorValue > 65535) {
         std::cerr << "Error: Invalid or incomplete PPM header (width, height, maxVal) in " << filename << "." << std::endl;
         std::cerr << "Read: width=" << width << ", height=" << height << ", maxVal=" << maxColorValue << std::endl;
         image.isValid = false;
-        ifs.close();
         return image;
     }
 
-    image.width = width;
-    image.height = height;
-    // Optional: Print dimensions
-    // std::cout << "Dimensions: " << image.width << "x" << image.height << ", Max Color Value: " << maxColorValue << std::endl;
+    image.width = (int)width;
+    image.height = (int)height;
+
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    const unsigned channels = format == '5' ? 1 : 3;
+    const size_t sampleCount = pixelCount * channels;
+    const size_t bytesPerSample = maxColorValue > 255 ? 2 : 1;
 
-    // Allocate memory for image data (RGB, so 3 bytes per pixel)
-    image.data.resize(static_cast<size_t>(image.width) * image.height * 3);
+    // A single whitespace byte separates the header from a binary payload
+    if (format != '3' && p < end) ++p;
 
-    int r, g, b; // Temporary variables for reading pixel components
-    for (size_t i = 0; i < static_cast<size_t>(image.width) * image.height; ++i) {
-        if (!(ifs >> r >> g >> b)) { // Read RGB values for each pixel
-            std::cerr << "Error: Failed to read pixel data at pixel index " << i << " from " << filename << "." << std::endl;
-            // More detailed stream state for debugging:
-            // std::cerr << "Stream state: good=" << ifs.good() << " eof=" << ifs.eof() << " fail=" << ifs.fail() << " bad=" << ifs.bad() << std::endl;
+    // Make sure the payload can hold every sample before allocating for them,
+    // so a bogus header fails here rather than allocating gigabytes. Binary
+    // samples have a fixed size; ASCII ones need a digit and a separator.
+    const size_t minimumPayload = format == '3' ? sampleCount * 2 - 1 : sampleCount * bytesPerSample;
+    if (static_cast<size_t>(end - p) < minimumPayload) {
+        std::cerr << "Error: Truncated pixel data in " << filename << "." << std::endl;
+        image.isValid = false;
+        return image;
+    }
+
+    // Allocate memory for image data (RGB, so 3 bytes per pixel); grayscale is
+    // decoded into the front and widened at the end
+    image.data.resize(pixelCount * 3);
+    unsigned char* out = image.data.data();
+
+    if (format == '3') {
+        // 8-bit files are written directly, other ranges go through the rescaler
+        const bool parallel = jobs != nullptr && jobs->getWorkerCount() >= parallelMinWorkers &&
+                              (size_t)(end - p) > parallelChunkBytes * parallelChunksPerWorker * jobs->getWorkerCount();
+        std::vector<uint16_t> wide(maxColorValue == 255 ? 0 : sampleCount);
+        bool parsed;
+        if (maxColorValue == 255) {
+            parsed = parallel ? parseAsciiSamplesParallel(p, end, sampleCount, 255u, out, *jobs)
+                              : parseAsciiSamples(p, end, sampleCount, 255u, out);
+        } else {
+            parsed = parallel ? parseAsciiSamplesParallel(p, end, sampleCount, maxColorValue, wide.data(), *jobs)
+                              : parseAsciiSamples(p, end, sampleCount, maxColorValue, wide.data());
+            if (parsed) rescaleSamples(wide.data(), sampleCount, maxColorValue, out);
+        }
+        if (!parsed) {
+            std::cerr << "Error: Failed to read pixel data from " << filename << "." << std::endl;
             image.isValid = false;
             image.data.clear(); // Clear partially filled data
-            ifs.close();
             return image;
         }
-        // Assuming maxColorValue is 255. If it could be different and pixel values need scaling,
-        // that logic would go here. For typical 8-bit PPMs, maxColorValue is 255.
-        image.data[i * 3 + 0] = static_cast<unsigned char>(r);
-        image.data[i * 3 + 1] = static_cast<unsigned char>(g);
-        image.data[i * 3 + 2] = static_cast<unsigned char>(b);
+    } else {
+        const unsigned char* payload = reinterpret_cast<const unsigned char*>(p);
+        if (bytesPerSample == 1 && maxColorValue == 255) {
+            std::memcpy(out, payload, sampleCount);
+        } else {
+            std::vector<uint16_t> wide(sampleCount);
+            if (bytesPerSample == 2) {
+                loadBigEndianSamples(payload, sampleCount, wide.data());
+            } else {
+                for (size_t i = 0; i < sampleCount; ++i) wide[i] = payload[i];
+            }
+            rescaleSamples(wide.data(), sampleCount, maxColorValue, out);
+        }
     }
 
-    ifs.close();
+    if (channels == 1) expandGrayToRGB(image.data, pixelCount);
+
     image.isValid = true;
     std::cout << "Successfully loaded PPM file: " << filename << std::endl;
     return image;
@@ -0,0 +1,55 @@
+// Checks that MappedFile opens regular files, including empty ones, and
+// refuses paths that are not regular files (a directory used to read as a
+// bogus size and abort in std::bad_alloc) or do not exist.
+// Exits non-zero on the first failure.
+//
+//   g++ -std=c++11 -O2 -Iinclude tests/mapped_file_test.cpp src/MappedFile.cpp -o mapped_file_test
+//   ./mapped_file_test
+
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+    std::printf("%s: %s\n", condition ? "passed" : "FAILED", what);
+    if (!condition) ++failures;
+}
+
+bool writeFile(const std::string& path, const char* text) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(text, 1, std::strlen(text), file) == std::strlen(text);
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+int main()
+{
+    MappedFile file;
+
+    // The working directory is always a directory, on every platform
+    expect(!file.open(".") && !file.isOpen(), "a directory is refused");
+    expect(!file.open("mapped_file_test.missing") && !file.isOpen(), "a missing file is refused");
+
+    const std::string path = "mapped_file_test.tmp";
+    const char* text = "P3 1 1 255\n1 2 3\n";
+    if (writeFile(path, text)) {
+        expect(file.open(path) && file.size() == std::strlen(text) && std::memcmp(file.data(), text, file.size()) == 0,
+               "a regular file is read whole");
+        file.close();
+        expect(writeFile(path, "") && file.open(path) && file.size() == 0, "an empty file opens with size 0");
+        file.close();
+        std::remove(path.c_str());
+    } else {
+        expect(false, "could not write the test file");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+// Steps one random body set through every integration kernel the CPU
+// supports and checks them against the Scalar kernel:
+//   - every step, each kernel advanced from the Scalar state must stay within
+//     PhysicsWorld::kernelTolerance of it (relative, absolute below 1)
+//   - without FMA contraction, whole trajectories (collisions included) must
+//     be bit identical
+// Exits non-zero if any kernel fails.
+//
+//   g++ -std=c++11 -O2 -ffp-contract=off -Iinclude tests/physics_kernel_test.cpp src/PhysicsWorld.cpp src/PhysicsWorldSIMD.cpp src/PhysicsObject.cpp src/CollisionGrid.cpp src/CpuFeatures.cpp src/JobSystem.cpp -pthread -o physics_kernel_test
+//   ./physics_kernel_test
+
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Bit equality holds unless the compiler fuses the scalar kernel's mul/add
+// pairs into FMAs, which it can only do for a target with FMA (and GCC only
+// does by default in -std=gnu++ modes). Build with
+// -DPHYSICS_KERNEL_TEST_EXACT=1 to demand it on such a target anyway.
+#ifndef PHYSICS_KERNEL_TEST_EXACT
+    #if defined(__FMA__) || defined(__aarch64__)
+        #define PHYSICS_KERNEL_TEST_EXACT 0
+    #else
+        #define PHYSICS_KERNEL_TEST_EXACT 1
+    #endif
+#endif
+
+namespace {
+
+// Not a multiple of 8, so every kernel's scalar tail runs too
+const size_t bodyCount = 1003;
+const int stepCount = 600;
+const float stepTime = 1.0f / 120.0f;
+
+// Bodies spread over the box, some resting on or below the floor so the
+// bounce masks and the x-velocity threshold see both outcomes
+void addRandomBodies(PhysicsWorld& world) {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    world.reserve(bodyCount);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        vec3 position(unit(random) * 2.0f, world.floorY + (unit(random) + 1.0f) * 1.5f - 0.1f, unit(random) * 2.0f);
+        vec3 velocity(i % 5 == 0 ? unit(random) * 0.02f : unit(random) * 3.0f, unit(random) * 3.0f, unit(random) * 3.0f);
+        world.addBody(position, velocity, 0.5f + (unit(random) + 1.0f), 0.05f + (unit(random) + 1.0f) * 0.05f);
+    }
+}
+
+// The same pseudo-random force on every body of every world at a given step
+void applyForces(PhysicsWorld& world, int step) {
+    std::mt19937 random((unsigned)step);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (size_t i = 0; i < world.size(); ++i) {
+        world.applyForce(i, vec3(unit(random), unit(random), unit(random)));
+    }
+}
+
+struct Field {
+    const char* name;
+    std::vector<float> PhysicsWorld::*values;
+};
+
+const Field stateFields[] = {
+    { "x", &PhysicsWorld::x }, { "y", &PhysicsWorld::y }, { "z", &PhysicsWorld::z },
+    { "vx", &PhysicsWorld::vx }, { "vy", &PhysicsWorld::vy }, { "vz", &PhysicsWorld::vz },
+};
+
+// Largest difference over the state, relative to the magnitude when that is above 1
+float maxDifference(const PhysicsWorld& a, const PhysicsWorld& b, const char*& worstField, size_t& worstBody) {
+    float worst = 0.0f;
+    for (const Field& field : stateFields) {
+        const std::vector<float>& u = a.*field.values;
+        const std::vector<float>& v = b.*field.values;
+        for (size_t i = 0; i < u.size(); ++i) {
+            float scale = std::max(1.0f, std::max(std::fabs(u[i]), std::fabs(v[i])));
+            float difference = std::fabs(u[i] - v[i]) / scale;
+            if (!(difference <= worst)) { // NaN counts as the worst
+                worst = difference;
+                worstField = field.name;
+                worstBody = i;
+            }
+        }
+    }
+    return worst;
+}
+
+bool bitIdentical(const PhysicsWorld& a, const PhysicsWorld& b) {
+    for (const Field& field : stateFields) {
+        const std::vector<float>& u = a.*field.values;
+        const std::vector<float>& v = b.*field.values;
+        if (std::memcmp(u.data(), v.data(), u.size() * sizeof(float)) != 0) return false;
+    }
+    return true;
+}
+
+// Per-step check: each step starts the kernel from the Scalar kernel's
+// state, so differences cannot build up over the run
+bool checkSteps(PhysicsKernel kernel) {
+    PhysicsWorld reference;
+    reference.setKernel(PhysicsKernel::Scalar);
+    addRandomBodies(reference);
+    float worst = 0.0f;
+    for (int step = 0; step < stepCount; ++step) {
+        PhysicsWorld candidate = reference;
+        candidate.setKernel(kernel);
+        applyForces(reference, step);
+        applyForces(candidate, step);
+        reference.update(stepTime);
+        candidate.update(stepTime);
+
+        const char* field = "";
+        size_t body = 0;
+        float difference = maxDifference(reference, candidate, field, body);
+        worst = std::max(worst, difference);
+        if (!(difference <= PhysicsWorld::kernelTolerance)) {
+            std::printf("  step %d: %s of body %zu differs by %g (tolerance %g)\n", step, field, body, difference,
+                        PhysicsWorld::kernelTolerance);
+            return false;
+        }
+        if (PHYSICS_KERNEL_TEST_EXACT && difference != 0.0f) {
+            std::printf("  step %d: %s of body %zu differs by %g, expected bit equality\n", step, field, body, difference);
+            return false;
+        }
+    }
+    std::printf("  %d steps, largest per-step difference %g\n", stepCount, worst);
+    return true;
+}
+
+// Whole-run check: both worlds run independently from the same start
+bool checkTrajectory(PhysicsKernel kernel) {
+    PhysicsWorld reference, candidate;
+    reference.setKernel(PhysicsKernel::Scalar);
+    candidate.setKernel(kernel);
+    addRandomBodies(reference);
+    addRandomBodies(candidate);
+    for (int step = 0; step < stepCount; ++step) {
+        applyForces(reference, step);
+        applyForces(candidate, step);
+        reference.update(stepTime);
+        candidate.update(stepTime);
+        if (!bitIdentical(reference, candidate)) {
+            std::printf("  trajectories diverge at step %d\n", step);
+            return false;
+        }
+    }
+    std::printf("  %d steps, trajectories bit identical\n", stepCount);
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    std::printf("%zu bodies, %s\n", bodyCount,
+                PHYSICS_KERNEL_TEST_EXACT ? "expecting bit equality" : "FMA contraction possible, checking tolerance only");
+
+    bool passed = true;
+    const PhysicsKernel kernels[] = { PhysicsKernel::SSE, PhysicsKernel::AVX2 };
+    for (PhysicsKernel kernel : kernels) {
+        PhysicsWorld probe;
+        probe.setKernel(kernel);
+        if (probe.getKernel() != kernel) {
+            std::printf("%s: not supported here, skipped\n", PhysicsWorld::kernelName(kernel));
+            continue;
+        }
+        std::printf("%s against Scalar:\n", PhysicsWorld::kernelName(kernel));
+        bool ok = checkSteps(kernel);
+        if (ok && PHYSICS_KERNEL_TEST_EXACT) ok = checkTrajectory(kernel);
+        std::printf("  %s\n", ok ? "passed" : "FAILED");
+        passed = passed && ok;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+// Checks that the serial and parallel ASCII (P3) paths of loadPPM agree:
+// both decode a valid file to the same pixels, and both reject a file with
+// a single sample above INT_MAX, which the parallel path once turned into
+// a zero. The large files go past the parallel threshold for two workers.
+// Exits non-zero on the first failure.
+//
+//   g++ -std=c++11 -O2 -Iinclude tests/ppm_loader_test.cpp src/ppm_loader.cpp src/MappedFile.cpp src/JobSystem.cpp src/CpuFeatures.cpp -pthread -o ppm_loader_test
+//   ./ppm_loader_test
+
+#include "JobSystem.h"
+#include "ppm_loader.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+const char* const testPath = "ppm_loader_test.ppm";
+
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+    std::printf("%s: %s\n", condition ? "passed" : "FAILED", what);
+    if (!condition) ++failures;
+}
+
+// A size x size 8-bit P3 file; badSample, when not negative, is replaced by
+// a number too large for the parser
+bool writeP3(int size, long badSample) {
+    std::ofstream out(testPath, std::ios::binary);
+    out << "P3\n" << size << " " << size << "\n255\n";
+    const long samples = (long)size * size * 3;
+    for (long i = 0; i < samples; ++i) {
+        if (i == badSample) out << "99999999999";
+        else out << (i * 7 % 256);
+        out << (i % 12 == 11 ? '\n' : ' ');
+    }
+    return (bool)out;
+}
+
+} // namespace
+
+int main()
+{
+    // Two workers and a 1200x1200 file (about 12 MB) take the parallel path
+    JobSystem jobs(2);
+    std::streambuf* console = std::cout.rdbuf(nullptr); // Mute "Successfully loaded"
+
+    bool written = writeP3(1200, -1);
+    PPMImage serial = loadPPM(testPath);
+    PPMImage parallel = loadPPM(testPath, &jobs);
+    std::cout.rdbuf(console);
+    expect(written && serial.isValid && parallel.isValid && serial.data == parallel.data,
+           "a valid file decodes to the same pixels on both paths");
+
+    std::cout.rdbuf(nullptr);
+    written = writeP3(1200, 1200L * 1200 * 3 / 2);
+    serial = loadPPM(testPath);
+    parallel = loadPPM(testPath, &jobs);
+    std::cout.rdbuf(console);
+    expect(written && !serial.isValid, "the serial path rejects a sample above INT_MAX");
+    expect(written && !parallel.isValid, "the parallel path rejects a sample above INT_MAX");
+
+    std::cout.rdbuf(nullptr);
+    written = writeP3(4, 5);
+    serial = loadPPM(testPath);
+    std::cout.rdbuf(console);
+    expect(written && !serial.isValid, "a small file with a sample above INT_MAX is rejected");
+
+    std::remove(testPath);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Post-transform cache report for the sphere mesh levels: ACMR (vertex
+// shader runs per triangle) and ATVR (runs per vertex) of each level in the
+// generator's order and after the reordering passes SphereMesh applies
+// (optimizeVertexCache, then optimizeVertexFetch), from a FIFO cache
+// simulation. UV levels that have compile-time tables also report the
+// baked stripe order, which is what the renderer uploads for them.
+//
+//   g++ -std=c++11 -O2 -Iinclude tools/mesh_cache_report.cpp src/MeshOptimizer.cpp src/SphereGenerators.cpp src/SphereMeshTables.cpp -o mesh_cache_report
+//   ./mesh_cache_report [cache size, default 16]
+
+#include "MeshOptimizer.h"
+#include "SphereGenerators.h"
+#include "SphereMeshTables.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// The levels main.cpp builds, finest first
+const int uvLevels[] = { 50, 32, 20, 12, 8 };
+const int icosphereLevels[] = { 4, 3, 2, 1 };
+const int cubeSphereLevels[] = { 20, 12, 8, 4, 2 };
+
+// Row-by-row index order of SphereMesh's generated UV sphere
+void uvSphereIndices(int bands, std::vector<GLuint>& indices, size_t& vertexCount) {
+    const GLuint rowVertices = (GLuint)bands + 1;
+    vertexCount = (size_t)rowVertices * rowVertices;
+    indices.clear();
+    for (int lat = 0; lat < bands; ++lat) {
+        for (int lon = 0; lon < bands; ++lon) {
+            GLuint first = (GLuint)lat * rowVertices + (GLuint)lon;
+            GLuint second = first + rowVertices;
+            const GLuint quad[6] = { first, second, first + 1, second, second + 1, first + 1 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+void printStats(const char* label, const VertexCacheStats& stats) {
+    std::printf("  %-10s ACMR %.3f  ATVR %.3f", label, stats.acmr, stats.atvr);
+}
+
+// Reports one level: generated order, then optimized like SphereMesh::optimizeLevel
+void reportLevel(const char* topology, int detail, std::vector<GLuint>& indices, size_t vertexCount, unsigned cacheSize) {
+    std::printf("%-11s %3d: %6zu triangles %6zu vertices\n", topology, detail, indices.size() / 3, vertexCount);
+    printStats("generated", analyzeVertexCache(indices.data(), indices.size(), vertexCount, cacheSize));
+    std::printf("\n");
+    optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    optimizeVertexFetch(indices.data(), indices.size(), vertexCount);
+    printStats("optimized", analyzeVertexCache(indices.data(), indices.size(), vertexCount, cacheSize));
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned cacheSize = 16;
+    if (argc > 1) {
+        int requested = std::atoi(argv[1]);
+        if (requested < 3) {
+            std::fprintf(stderr, "Usage: mesh_cache_report [cache size >= 3]\n");
+            return 2;
+        }
+        cacheSize = (unsigned)requested;
+    }
+    std::printf("%u-entry FIFO post-transform cache\n", cacheSize);
+
+    std::vector<GLuint> indices;
+    size_t vertexCount = 0;
+    for (int bands : uvLevels) {
+        uvSphereIndices(bands, indices, vertexCount);
+        reportLevel("UV sphere", bands, indices, vertexCount, cacheSize);
+        if (const SphereTable* table = findSphereTable(bands)) {
+            printStats("baked", analyzeVertexCache(table->indices, table->indexCount, table->vertexCount, cacheSize));
+            std::printf("\n");
+        }
+    }
+
+    SphereGeometry geometry;
+    for (int subdivisions : icosphereLevels) {
+        geometry = SphereGeometry();
+        generateIcosphere(subdivisions, geometry);
+        addSphereTexCoords(geometry);
+        reportLevel("Icosphere", subdivisions, geometry.indices, geometry.directions.size(), cacheSize);
+    }
+    for (int divisions : cubeSphereLevels) {
+        geometry = SphereGeometry();
+        generateCubeSphere(divisions, geometry);
+        addSphereTexCoords(geometry);
+        reportLevel("Cube sphere", divisions, geometry.indices, geometry.directions.size(), cacheSize);
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Offline half of the texture compressor: writes "<image>.texcache" for
+// each PPM ahead of time, with the same mip filter and BC1/BC7 encoder the
+// renderer runs on a cache miss, so a shipped build never compresses at
+// startup. Bake the format the target GPU is given (BC7 with
+// ARB_texture_compression_bptc, else BC1 with EXT_texture_compression_s3tc,
+// else RGB8); a cache in any other format is rebuilt at runtime. Exits
+// non-zero, naming the file, when a source cannot be loaded or its cache
+// cannot be written.
+//
+//   g++ -std=c++11 -O2 -Iinclude tools/texcache_bake.cpp src/TextureCache.cpp src/BlockCompression.cpp src/Mipmap.cpp src/ppm_loader.cpp src/MappedFile.cpp src/JobSystem.cpp src/CpuFeatures.cpp -pthread -o texcache_bake
+//   ./texcache_bake [--format rgb8|bc1|bc7] [--force] image.ppm ...
+
+#include "JobSystem.h"
+#include "TextureCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool parseFormat(const char* name, TextureFormat& format) {
+    const TextureFormat formats[] = { TextureFormat::RGB8, TextureFormat::BC1, TextureFormat::BC7 };
+    for (TextureFormat candidate : formats) {
+        const char* candidateName = textureFormatName(candidate);
+        size_t length = std::strlen(candidateName);
+        bool same = std::strlen(name) == length;
+        for (size_t i = 0; same && i < length; ++i) {
+            same = (name[i] | 0x20) == (candidateName[i] | 0x20); // Case-insensitive for letters and digits
+        }
+        if (same) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void printUsage() {
+    std::cerr << "Usage: texcache_bake [--format rgb8|bc1|bc7] [--force] image.ppm ..." << std::endl
+              << "  --format  Texture format to store (default bc7)" << std::endl
+              << "  --force   Rebuild caches that are already up to date" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    TextureFormat format = TextureFormat::BC7;
+    bool force = false;
+    std::vector<std::string> sources;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!parseFormat(argv[++i], format)) {
+                std::cerr << "Unknown format " << argv[i] << std::endl;
+                printUsage();
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else if (argv[i][0] == '-') {
+            printUsage();
+            return 2;
+        } else {
+            sources.push_back(argv[i]);
+        }
+    }
+    if (sources.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    JobSystem jobs;
+    int failures = 0;
+    for (const std::string& source : sources) {
+        if (force) std::remove((source + ".texcache").c_str());
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        CachedTexture texture;
+        bool stored = false;
+        if (!texture.load(source, format, &jobs, &stored)) {
+            std::cerr << "Failed to bake " << source << ": could not load it" << std::endl;
+            ++failures;
+            continue;
+        }
+        if (!stored) {
+            std::cerr << "Failed to bake " << source << ": could not write " << source << ".texcache" << std::endl;
+            ++failures;
+            continue;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t bytes = 0;
+        for (const TextureLevel& level : texture.getLevels()) bytes += level.size;
+        std::printf("%s.texcache: %s, %dx%d, %zu levels, %zu bytes, %s (%.2f s)\n", source.c_str(),
+                    textureFormatName(texture.getFormat()), texture.getWidth(), texture.getHeight(),
+                    texture.getLevels().size(), bytes, texture.isFromCache() ? "already up to date" : "baked", seconds);
+    }
+    return failures == 0 ? 0 : 1;
+}